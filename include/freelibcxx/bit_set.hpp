@@ -203,7 +203,8 @@ class bit_set
         : element_count_(element_count)
         , allocator_(allocator)
     {
-        CXXASSERT(is_pow_of_2(element_count));
+        // whole words work as well, the bloom filter sizes its bits exactly
+        CXXASSERT(is_pow_of_2(element_count) || element_count % 64 == 0);
         size_t bytes = (element_count + 7) / 8;
         data_ = reinterpret_cast<size_t *>(allocator->allocate(bytes, 8));
     }
@@ -211,7 +212,42 @@ class bit_set
     bit_set(const bit_set &v) = delete;
     bit_set &operator=(const bit_set &v) = delete;
 
-    ~bit_set() { allocator_->deallocate(data_); }
+    bit_set(bit_set &&rhs) noexcept
+        : data_(rhs.data_)
+        , element_count_(rhs.element_count_)
+        , allocator_(rhs.allocator_)
+    {
+        rhs.data_ = nullptr;
+        rhs.element_count_ = 0;
+    }
+
+    bit_set &operator=(bit_set &&rhs) noexcept
+    {
+        if (this == &rhs) [[unlikely]]
+            return *this;
+        if (data_ != nullptr)
+        {
+            allocator_->deallocate(data_);
+        }
+        data_ = rhs.data_;
+        element_count_ = rhs.element_count_;
+        allocator_ = rhs.allocator_;
+        rhs.data_ = nullptr;
+        rhs.element_count_ = 0;
+        return *this;
+    }
+
+    ~bit_set()
+    {
+        if (data_ != nullptr)
+        {
+            allocator_->deallocate(data_);
+        }
+    }
+
+    size_t *get_ptr() { return data_; }
+
+    const size_t *get_ptr() const { return data_; }
 
     FREELIBCXX_BITSET_FN;
 };
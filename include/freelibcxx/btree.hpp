@@ -0,0 +1,1010 @@
+#pragma once
+#include "freelibcxx/allocator.hpp"
+#include "freelibcxx/assert.hpp"
+#include "freelibcxx/optional.hpp"
+#include "freelibcxx/span.hpp"
+#include "freelibcxx/vector.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+namespace freelibcxx
+{
+
+/// A B+ tree, elements live in the leaves and the leaves are linked in key order.
+/// A node is NODE_BYTES rounded up to cache lines, the keys of a node are contiguous
+/// and searched with a branch free binary search. V is void for a set.
+template <typename K, typename V, typename Compare, size_t NODE_BYTES> class base_btree
+{
+  protected:
+    static constexpr bool is_set = std::is_void_v<V>;
+    using value_t = std::conditional_t<is_set, char, V>;
+
+    static constexpr size_t round_up(size_t n, size_t align) { return (n + align - 1) / align * align; }
+
+    struct node_t
+    {
+        uint32_t count;
+    };
+
+    struct leaf_t;
+
+    struct leaf_header_t : node_t
+    {
+        leaf_t *prev;
+        leaf_t *next;
+    };
+
+    static constexpr size_t node_bytes = round_up(NODE_BYTES, 64);
+
+    // layout of leaf_t and inner_t with n slots
+    static constexpr size_t leaf_bytes(size_t n)
+    {
+        size_t keys_end = round_up(sizeof(leaf_header_t), alignof(K)) + sizeof(K) * n;
+        return round_up(round_up(keys_end, alignof(value_t)) + (is_set ? 0 : sizeof(value_t) * n), 64);
+    }
+
+    static constexpr size_t inner_bytes(size_t n)
+    {
+        size_t keys_end = round_up(sizeof(node_t), alignof(K)) + sizeof(K) * n;
+        return round_up(round_up(keys_end, alignof(void *)) + sizeof(void *) * (n + 1), 64);
+    }
+
+    /// Most slots that fit in node_bytes, at least 3
+    static constexpr size_t slots(size_t (*bytes)(size_t))
+    {
+        size_t n = 3;
+        while (bytes(n + 1) <= node_bytes)
+        {
+            n++;
+        }
+        return n;
+    }
+
+    static constexpr size_t leaf_slots = slots(leaf_bytes);
+    static constexpr size_t inner_slots = slots(inner_bytes);
+    static constexpr size_t min_leaf = leaf_slots / 2;
+    static constexpr size_t min_inner = inner_slots / 2;
+    static constexpr int max_height = 64;
+
+    struct alignas(64) leaf_t : leaf_header_t
+    {
+        alignas(K) unsigned char key_data[sizeof(K) * leaf_slots];
+        alignas(value_t) unsigned char value_data[is_set ? 0 : sizeof(value_t) * leaf_slots];
+
+        K *keys() { return (K *)key_data; }
+        value_t *values() { return (value_t *)value_data; }
+    };
+
+    struct alignas(64) inner_t : node_t
+    {
+        alignas(K) unsigned char key_data[sizeof(K) * inner_slots];
+        node_t *children[inner_slots + 1];
+
+        K *keys() { return (K *)key_data; }
+    };
+
+    static_assert(sizeof(leaf_t) == leaf_bytes(leaf_slots));
+    static_assert(sizeof(inner_t) == inner_bytes(inner_slots));
+    // only a node at the minimum of 3 slots may be larger
+    static_assert(sizeof(leaf_t) <= node_bytes || leaf_slots == 3);
+    static_assert(sizeof(inner_t) <= node_bytes || inner_slots == 3);
+
+    template <bool Const> class base_iterator
+    {
+        using key_ref = const K &;
+        using value_ref = std::conditional_t<Const, const value_t &, value_t &>;
+
+      public:
+        base_iterator(leaf_t *leaf, size_t index)
+            : leaf_(leaf)
+            , index_(index)
+        {
+        }
+
+        key_ref key() const { return leaf_->keys()[index_]; }
+
+        value_ref value() const
+        requires(!is_set)
+        {
+            return leaf_->values()[index_];
+        }
+
+        key_ref operator*() const
+        requires is_set
+        {
+            return leaf_->keys()[index_];
+        }
+
+        base_iterator &operator++()
+        {
+            if (++index_ == leaf_->count)
+            {
+                leaf_ = leaf_->next;
+                index_ = 0;
+            }
+            return *this;
+        }
+
+        base_iterator operator++(int)
+        {
+            auto old = *this;
+            ++*this;
+            return old;
+        }
+
+        /// Not valid on end()
+        base_iterator &operator--()
+        {
+            if (index_ == 0)
+            {
+                leaf_ = leaf_->prev;
+                index_ = leaf_->count;
+            }
+            index_--;
+            return *this;
+        }
+
+        base_iterator operator--(int)
+        {
+            auto old = *this;
+            --*this;
+            return old;
+        }
+
+        bool operator==(const base_iterator &rhs) const { return leaf_ == rhs.leaf_ && index_ == rhs.index_; }
+        bool operator!=(const base_iterator &rhs) const { return !(*this == rhs); }
+
+      private:
+        leaf_t *leaf_;
+        size_t index_;
+
+        friend class base_btree;
+    };
+
+  public:
+    using iterator = base_iterator<false>;
+    using const_iterator = base_iterator<true>;
+
+    explicit base_btree(Allocator *allocator, Compare compare = Compare())
+        : root_(nullptr)
+        , first_(nullptr)
+        , last_(nullptr)
+        , height_(0)
+        , count_(0)
+        , compare_(std::move(compare))
+        , allocator_(allocator)
+    {
+    }
+
+    base_btree(const base_btree &rhs)
+        : root_(nullptr)
+        , first_(nullptr)
+        , last_(nullptr)
+        , height_(rhs.height_)
+        , count_(rhs.count_)
+        , compare_(rhs.compare_)
+        , allocator_(rhs.allocator_)
+    {
+        copy(rhs);
+    }
+
+    base_btree(base_btree &&rhs) noexcept
+        : root_(rhs.root_)
+        , first_(rhs.first_)
+        , last_(rhs.last_)
+        , height_(rhs.height_)
+        , count_(rhs.count_)
+        , compare_(rhs.compare_)
+        , allocator_(rhs.allocator_)
+    {
+        rhs.reset();
+    }
+
+    ~base_btree() { clear(); }
+
+    base_btree &operator=(const base_btree &rhs)
+    {
+        if (this == &rhs)
+            return *this;
+        clear();
+        height_ = rhs.height_;
+        count_ = rhs.count_;
+        compare_ = rhs.compare_;
+        allocator_ = rhs.allocator_;
+        copy(rhs);
+        return *this;
+    }
+
+    base_btree &operator=(base_btree &&rhs) noexcept
+    {
+        if (this == &rhs)
+            return *this;
+        clear();
+        root_ = rhs.root_;
+        first_ = rhs.first_;
+        last_ = rhs.last_;
+        height_ = rhs.height_;
+        count_ = rhs.count_;
+        compare_ = rhs.compare_;
+        allocator_ = rhs.allocator_;
+        rhs.reset();
+        return *this;
+    }
+
+    bool remove(const K &key)
+    {
+        if (root_ == nullptr)
+        {
+            return false;
+        }
+        inner_t *path[max_height];
+        uint32_t path_slots[max_height];
+        leaf_t *leaf = descend(key, path, path_slots);
+        size_t index = lower_index(leaf->keys(), leaf->count, key);
+        if (index == leaf->count || compare_(key, leaf->keys()[index]))
+        {
+            return false;
+        }
+        erase_at(leaf->keys(), index, leaf->count);
+        if constexpr (!is_set)
+        {
+            erase_at(leaf->values(), index, leaf->count);
+        }
+        leaf->count--;
+        count_--;
+        if (height_ == 0)
+        {
+            if (leaf->count == 0)
+            {
+                free_node(leaf);
+                reset();
+            }
+        }
+        else if (leaf->count < min_leaf)
+        {
+            rebalance_leaf(leaf, path, path_slots);
+        }
+        return true;
+    }
+
+    iterator remove(iterator iter)
+    {
+        K key = iter.key();
+        remove(key);
+        return lower_find(key);
+    }
+
+    iterator find(const K &key)
+    {
+        iterator it = lower_find(key);
+        if (it != end() && !compare_(key, it.key()))
+        {
+            return it;
+        }
+        return end();
+    }
+
+    const_iterator find(const K &key) const { return to_const(const_cast<base_btree *>(this)->find(key)); }
+
+    bool has(const K &key) const { return find(key) != end(); }
+
+    /// \return The first element whose key is not less than key
+    iterator lower_find(const K &key)
+    {
+        if (root_ == nullptr)
+        {
+            return end();
+        }
+        leaf_t *leaf = descend(key, nullptr, nullptr);
+        return normalize(leaf, lower_index(leaf->keys(), leaf->count, key));
+    }
+
+    const_iterator lower_find(const K &key) const { return to_const(const_cast<base_btree *>(this)->lower_find(key)); }
+
+    /// \return The first element whose key is greater than key
+    iterator upper_find(const K &key)
+    {
+        if (root_ == nullptr)
+        {
+            return end();
+        }
+        leaf_t *leaf = descend(key, nullptr, nullptr);
+        return normalize(leaf, upper_index(leaf->keys(), leaf->count, key));
+    }
+
+    const_iterator upper_find(const K &key) const { return to_const(const_cast<base_btree *>(this)->upper_find(key)); }
+
+    void clear() noexcept
+    {
+        if (root_ != nullptr)
+        {
+            destroy(root_, height_);
+        }
+        reset();
+    }
+
+    size_t size() const { return count_; }
+
+    bool empty() const { return count_ == 0; }
+
+    /// Levels above the leaves
+    size_t height() const { return height_; }
+
+    iterator begin() { return iterator(first_, 0); }
+
+    iterator end() { return iterator(nullptr, 0); }
+
+    const_iterator begin() const { return const_iterator(first_, 0); }
+
+    const_iterator end() const { return const_iterator(nullptr, 0); }
+
+  protected:
+    node_t *root_;
+    leaf_t *first_;
+    leaf_t *last_;
+    int height_;
+    size_t count_;
+    Compare compare_;
+    Allocator *allocator_;
+
+    void reset()
+    {
+        root_ = nullptr;
+        first_ = nullptr;
+        last_ = nullptr;
+        height_ = 0;
+        count_ = 0;
+    }
+
+    static const_iterator to_const(iterator it) { return const_iterator(it.leaf_, it.index_); }
+
+    // the end of a leaf is the beginning of the next one
+    static iterator normalize(leaf_t *leaf, size_t index)
+    {
+        if (index == leaf->count)
+        {
+            return iterator(leaf->next, 0);
+        }
+        return iterator(leaf, index);
+    }
+
+    // branch free lower bound, the compiler selects instead of jumping
+    size_t lower_index(K *keys, size_t count, const K &key) const
+    {
+        if (count == 0)
+        {
+            return 0;
+        }
+        const K *base = keys;
+        while (count > 1)
+        {
+            size_t half = count / 2;
+            base += compare_(base[half - 1], key) ? half : 0;
+            count -= half;
+        }
+        return base - keys + compare_(*base, key);
+    }
+
+    size_t upper_index(K *keys, size_t count, const K &key) const
+    {
+        if (count == 0)
+        {
+            return 0;
+        }
+        const K *base = keys;
+        while (count > 1)
+        {
+            size_t half = count / 2;
+            base += compare_(key, base[half - 1]) ? 0 : half;
+            count -= half;
+        }
+        return base - keys + !compare_(key, *base);
+    }
+
+    /// Walk to the leaf of key
+    /// Child i of an inner node holds the keys in [keys[i - 1], keys[i])
+    ///
+    /// \param path the inner node of each level, path[0] is the parent of the leaf
+    /// \param path_slots the child index taken on each level
+    leaf_t *descend(const K &key, inner_t **path, uint32_t *path_slots) const
+    {
+        node_t *node = root_;
+        for (int h = height_; h > 0; h--)
+        {
+            inner_t *inner = (inner_t *)node;
+            size_t slot = upper_index(inner->keys(), inner->count, key);
+            if (path != nullptr)
+            {
+                path[h - 1] = inner;
+                path_slots[h - 1] = slot;
+            }
+            node = inner->children[slot];
+        }
+        return (leaf_t *)node;
+    }
+
+    template <typename... Args> std::pair<iterator, bool> insert_key(const K &key, Args &&...args)
+    {
+        if (root_ == nullptr)
+        {
+            leaf_t *leaf = new_leaf();
+            root_ = leaf;
+            first_ = leaf;
+            last_ = leaf;
+        }
+        inner_t *path[max_height];
+        uint32_t path_slots[max_height];
+        leaf_t *leaf = descend(key, path, path_slots);
+        size_t index = lower_index(leaf->keys(), leaf->count, key);
+        if (index < leaf->count && !compare_(key, leaf->keys()[index]))
+        {
+            return std::make_pair(iterator(leaf, index), false);
+        }
+        if (leaf->count == leaf_slots)
+        {
+            leaf_t *right = split_leaf(leaf);
+            insert_child(path, path_slots, 0, right->keys()[0], right);
+            if (index > leaf->count)
+            {
+                index -= leaf->count;
+                leaf = right;
+            }
+        }
+        shift_right(leaf->keys(), index, leaf->count);
+        new (&leaf->keys()[index]) K(key);
+        if constexpr (!is_set)
+        {
+            shift_right(leaf->values(), index, leaf->count);
+            new (&leaf->values()[index]) V(std::forward<Args>(args)...);
+        }
+        leaf->count++;
+        count_++;
+        return std::make_pair(iterator(leaf, index), true);
+    }
+
+    /// Replace all elements by sorted elements with unique keys.
+    /// Leaves are filled evenly left to right, then every inner level above them
+    template <typename Fill> void build(size_t count, Fill fill)
+    {
+        clear();
+        if (count == 0)
+        {
+            return;
+        }
+        base_vector<node_t *> nodes(allocator_);
+        base_vector<K *> firsts(allocator_);
+        size_t leaves = (count + leaf_slots - 1) / leaf_slots;
+        nodes.ensure(leaves);
+        firsts.ensure(leaves);
+        size_t index = 0;
+        leaf_t *prev = nullptr;
+        for (size_t i = 0; i < leaves; i++)
+        {
+            leaf_t *leaf = new_leaf();
+            size_t n = count / leaves + (i < count % leaves);
+            for (size_t j = 0; j < n; j++)
+            {
+                fill(leaf, j, index++);
+            }
+            leaf->count = n;
+            leaf->prev = prev;
+            if (prev != nullptr)
+            {
+                prev->next = leaf;
+            }
+            else
+            {
+                first_ = leaf;
+            }
+            prev = leaf;
+            nodes.push_back(leaf);
+            firsts.push_back(leaf->keys());
+        }
+        last_ = prev;
+        count_ = count;
+
+        while (nodes.size() > 1)
+        {
+            size_t total = nodes.size();
+            size_t parents = (total + inner_slots) / (inner_slots + 1);
+            size_t child = 0;
+            for (size_t i = 0; i < parents; i++)
+            {
+                inner_t *inner = new_inner();
+                size_t n = total / parents + (i < total % parents);
+                K *first = firsts[child];
+                for (size_t j = 0; j < n; j++, child++)
+                {
+                    inner->children[j] = nodes[child];
+                    if (j > 0)
+                    {
+                        new (&inner->keys()[j - 1]) K(*firsts[child]);
+                    }
+                }
+                inner->count = n - 1;
+                nodes[i] = inner;
+                firsts[i] = first;
+            }
+            nodes.truncate(parents);
+            firsts.truncate(parents);
+            height_++;
+        }
+        root_ = nodes[0];
+    }
+
+    leaf_t *new_leaf()
+    {
+        leaf_t *leaf = (leaf_t *)allocator_->allocate(sizeof(leaf_t), alignof(leaf_t));
+        leaf->count = 0;
+        leaf->prev = nullptr;
+        leaf->next = nullptr;
+        return leaf;
+    }
+
+    inner_t *new_inner()
+    {
+        inner_t *inner = (inner_t *)allocator_->allocate(sizeof(inner_t), alignof(inner_t));
+        inner->count = 0;
+        return inner;
+    }
+
+    void free_node(node_t *node) { allocator_->deallocate(node); }
+
+    void destroy(node_t *node, int height)
+    {
+        if (height == 0)
+        {
+            leaf_t *leaf = (leaf_t *)node;
+            for (size_t i = 0; i < leaf->count; i++)
+            {
+                leaf->keys()[i].~K();
+                if constexpr (!is_set)
+                {
+                    leaf->values()[i].~V();
+                }
+            }
+        }
+        else
+        {
+            inner_t *inner = (inner_t *)node;
+            for (size_t i = 0; i <= inner->count; i++)
+            {
+                destroy(inner->children[i], height - 1);
+            }
+            for (size_t i = 0; i < inner->count; i++)
+            {
+                inner->keys()[i].~K();
+            }
+        }
+        free_node(node);
+    }
+
+    void copy(const base_btree &rhs)
+    {
+        if (rhs.root_ != nullptr)
+        {
+            leaf_t *prev = nullptr;
+            root_ = clone(rhs.root_, height_, prev);
+            last_ = prev;
+        }
+    }
+
+    node_t *clone(node_t *node, int height, leaf_t *&prev)
+    {
+        if (height == 0)
+        {
+            leaf_t *src = (leaf_t *)node;
+            leaf_t *leaf = new_leaf();
+            for (size_t i = 0; i < src->count; i++)
+            {
+                new (&leaf->keys()[i]) K(src->keys()[i]);
+                if constexpr (!is_set)
+                {
+                    new (&leaf->values()[i]) V(src->values()[i]);
+                }
+            }
+            leaf->count = src->count;
+            leaf->prev = prev;
+            if (prev != nullptr)
+            {
+                prev->next = leaf;
+            }
+            else
+            {
+                first_ = leaf;
+            }
+            prev = leaf;
+            return leaf;
+        }
+        inner_t *src = (inner_t *)node;
+        inner_t *inner = new_inner();
+        for (size_t i = 0; i < src->count; i++)
+        {
+            new (&inner->keys()[i]) K(src->keys()[i]);
+        }
+        for (size_t i = 0; i <= src->count; i++)
+        {
+            inner->children[i] = clone(src->children[i], height - 1, prev);
+        }
+        inner->count = src->count;
+        return inner;
+    }
+
+    // move [pos, count) one slot right
+    template <typename T> static void shift_right(T *items, size_t pos, size_t count)
+    {
+        for (size_t i = count; i > pos; i--)
+        {
+            new (&items[i]) T(std::move(items[i - 1]));
+            items[i - 1].~T();
+        }
+    }
+
+    // destroy pos and move (pos, count) one slot left
+    template <typename T> static void erase_at(T *items, size_t pos, size_t count)
+    {
+        items[pos].~T();
+        for (size_t i = pos + 1; i < count; i++)
+        {
+            new (&items[i - 1]) T(std::move(items[i]));
+            items[i].~T();
+        }
+    }
+
+    // move count items to uninitialized dst
+    template <typename T> static void move_to(T *dst, T *src, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            new (&dst[i]) T(std::move(src[i]));
+            src[i].~T();
+        }
+    }
+
+    /// Move the upper half of a full leaf to a new right sibling
+    leaf_t *split_leaf(leaf_t *leaf)
+    {
+        leaf_t *right = new_leaf();
+        size_t keep = leaf->count - leaf->count / 2;
+        size_t moved = leaf->count - keep;
+        move_to(right->keys(), leaf->keys() + keep, moved);
+        if constexpr (!is_set)
+        {
+            move_to(right->values(), leaf->values() + keep, moved);
+        }
+        right->count = moved;
+        leaf->count = keep;
+
+        right->prev = leaf;
+        right->next = leaf->next;
+        if (leaf->next != nullptr)
+        {
+            leaf->next->prev = right;
+        }
+        else
+        {
+            last_ = right;
+        }
+        leaf->next = right;
+        return right;
+    }
+
+    /// Insert separator and its right child next to the child taken on level,
+    /// splitting full inner nodes up to a new root
+    void insert_child(inner_t **path, uint32_t *path_slots, int level, const K &separator, node_t *child)
+    {
+        if (level == height_)
+        {
+            inner_t *root = new_inner();
+            new (&root->keys()[0]) K(separator);
+            root->children[0] = root_;
+            root->children[1] = child;
+            root->count = 1;
+            root_ = root;
+            height_++;
+            return;
+        }
+        inner_t *inner = path[level];
+        size_t pos = path_slots[level];
+        if (inner->count < inner_slots)
+        {
+            insert_inner(inner, pos, separator, child);
+            return;
+        }
+        // split around the middle key, which moves up
+        size_t mid = inner->count / 2;
+        inner_t *right = new_inner();
+        size_t moved = inner->count - mid - 1;
+        move_to(right->keys(), inner->keys() + mid + 1, moved);
+        for (size_t i = 0; i <= moved; i++)
+        {
+            right->children[i] = inner->children[mid + 1 + i];
+        }
+        right->count = moved;
+        K up(std::move(inner->keys()[mid]));
+        inner->keys()[mid].~K();
+        inner->count = mid;
+
+        if (pos <= mid)
+        {
+            insert_inner(inner, pos, separator, child);
+        }
+        else
+        {
+            insert_inner(right, pos - mid - 1, separator, child);
+        }
+        insert_child(path, path_slots, level + 1, up, right);
+    }
+
+    void insert_inner(inner_t *inner, size_t pos, const K &separator, node_t *child)
+    {
+        shift_right(inner->keys(), pos, inner->count);
+        new (&inner->keys()[pos]) K(separator);
+        for (size_t i = inner->count + 1; i > pos + 1; i--)
+        {
+            inner->children[i] = inner->children[i - 1];
+        }
+        inner->children[pos + 1] = child;
+        inner->count++;
+    }
+
+    // remove key pos and child pos + 1
+    void erase_inner(inner_t *inner, size_t pos)
+    {
+        erase_at(inner->keys(), pos, inner->count);
+        for (size_t i = pos + 1; i < inner->count; i++)
+        {
+            inner->children[i] = inner->children[i + 1];
+        }
+        inner->count--;
+    }
+
+    /// Refill a leaf under the minimum from a sibling, or merge it with one
+    void rebalance_leaf(leaf_t *leaf, inner_t **path, uint32_t *path_slots)
+    {
+        inner_t *parent = path[0];
+        size_t slot = path_slots[0];
+        leaf_t *left = slot > 0 ? (leaf_t *)parent->children[slot - 1] : nullptr;
+        leaf_t *right = slot < parent->count ? (leaf_t *)parent->children[slot + 1] : nullptr;
+        if (left != nullptr && left->count > min_leaf)
+        {
+            shift_right(leaf->keys(), 0, leaf->count);
+            move_to(leaf->keys(), left->keys() + left->count - 1, 1);
+            if constexpr (!is_set)
+            {
+                shift_right(leaf->values(), 0, leaf->count);
+                move_to(leaf->values(), left->values() + left->count - 1, 1);
+            }
+            left->count--;
+            leaf->count++;
+            parent->keys()[slot - 1] = leaf->keys()[0];
+            return;
+        }
+        if (right != nullptr && right->count > min_leaf)
+        {
+            move_to(leaf->keys() + leaf->count, right->keys(), 1);
+            shift_left_moved(right->keys(), right->count);
+            if constexpr (!is_set)
+            {
+                move_to(leaf->values() + leaf->count, right->values(), 1);
+                shift_left_moved(right->values(), right->count);
+            }
+            right->count--;
+            leaf->count++;
+            parent->keys()[slot] = right->keys()[0];
+            return;
+        }
+        if (left != nullptr)
+        {
+            merge_leaf(left, leaf);
+            erase_inner(parent, slot - 1);
+        }
+        else
+        {
+            merge_leaf(leaf, right);
+            erase_inner(parent, slot);
+        }
+        rebalance_inner(path, path_slots, 0);
+    }
+
+    // the first item was moved out, move the rest one slot left
+    template <typename T> static void shift_left_moved(T *items, size_t count)
+    {
+        for (size_t i = 1; i < count; i++)
+        {
+            new (&items[i - 1]) T(std::move(items[i]));
+            items[i].~T();
+        }
+    }
+
+    // append right to left and free right
+    void merge_leaf(leaf_t *left, leaf_t *right)
+    {
+        move_to(left->keys() + left->count, right->keys(), right->count);
+        if constexpr (!is_set)
+        {
+            move_to(left->values() + left->count, right->values(), right->count);
+        }
+        left->count += right->count;
+        left->next = right->next;
+        if (right->next != nullptr)
+        {
+            right->next->prev = left;
+        }
+        else
+        {
+            last_ = left;
+        }
+        free_node(right);
+    }
+
+    void rebalance_inner(inner_t **path, uint32_t *path_slots, int level)
+    {
+        inner_t *node = path[level];
+        if (level == height_ - 1)
+        {
+            if (node->count == 0)
+            {
+                root_ = node->children[0];
+                free_node(node);
+                height_--;
+            }
+            return;
+        }
+        if (node->count >= min_inner)
+        {
+            return;
+        }
+        inner_t *parent = path[level + 1];
+        size_t slot = path_slots[level + 1];
+        inner_t *left = slot > 0 ? (inner_t *)parent->children[slot - 1] : nullptr;
+        inner_t *right = slot < parent->count ? (inner_t *)parent->children[slot + 1] : nullptr;
+        if (left != nullptr && left->count > min_inner)
+        {
+            // rotate the last child of left through the parent
+            shift_right(node->keys(), 0, node->count);
+            new (&node->keys()[0]) K(std::move(parent->keys()[slot - 1]));
+            for (size_t i = node->count + 1; i > 0; i--)
+            {
+                node->children[i] = node->children[i - 1];
+            }
+            node->children[0] = left->children[left->count];
+            parent->keys()[slot - 1] = std::move(left->keys()[left->count - 1]);
+            left->keys()[left->count - 1].~K();
+            left->count--;
+            node->count++;
+            return;
+        }
+        if (right != nullptr && right->count > min_inner)
+        {
+            new (&node->keys()[node->count]) K(std::move(parent->keys()[slot]));
+            node->children[node->count + 1] = right->children[0];
+            parent->keys()[slot] = std::move(right->keys()[0]);
+            erase_at(right->keys(), 0, right->count);
+            for (size_t i = 0; i < right->count; i++)
+            {
+                right->children[i] = right->children[i + 1];
+            }
+            right->count--;
+            node->count++;
+            return;
+        }
+        if (left != nullptr)
+        {
+            merge_inner(left, node, parent->keys()[slot - 1]);
+            erase_inner(parent, slot - 1);
+        }
+        else
+        {
+            merge_inner(node, right, parent->keys()[slot]);
+            erase_inner(parent, slot);
+        }
+        rebalance_inner(path, path_slots, level + 1);
+    }
+
+    // append separator and right to left and free right
+    void merge_inner(inner_t *left, inner_t *right, const K &separator)
+    {
+        new (&left->keys()[left->count]) K(separator);
+        move_to(left->keys() + left->count + 1, right->keys(), right->count);
+        for (size_t i = 0; i <= right->count; i++)
+        {
+            left->children[left->count + 1 + i] = right->children[i];
+        }
+        left->count += right->count + 1;
+        free_node(right);
+    }
+};
+
+template <typename K, typename V, typename Compare = std::less<K>, size_t NODE_BYTES = 256>
+class btree_map : public base_btree<K, V, Compare, NODE_BYTES>
+{
+    using Parent = base_btree<K, V, Compare, NODE_BYTES>;
+
+  public:
+    using Parent::Parent;
+    using typename Parent::iterator;
+
+    /// Insert a new element only if key is absent
+    ///
+    /// \return The element with key, and whether it was inserted
+    template <typename... Args> std::pair<iterator, bool> insert(const K &key, Args &&...args)
+    {
+        return this->insert_key(key, std::forward<Args>(args)...);
+    }
+
+    /// Insert key with value, or assign value to the existing element
+    ///
+    /// \return The element with key, and whether it was inserted
+    template <typename M> std::pair<iterator, bool> insert_or_assign(const K &key, M &&value)
+    {
+        auto ret = this->insert_key(key, std::forward<M>(value));
+        if (!ret.second)
+        {
+            ret.first.value() = std::forward<M>(value);
+        }
+        return ret;
+    }
+
+    optional<V> get(const K &key) const
+    {
+        const V *v = get_ptr(key);
+        if (v == nullptr)
+        {
+            return nullopt;
+        }
+        return *v;
+    }
+
+    V *get_ptr(const K &key)
+    {
+        auto it = this->find(key);
+        if (it == this->end())
+        {
+            return nullptr;
+        }
+        return &it.value();
+    }
+
+    const V *get_ptr(const K &key) const { return const_cast<btree_map *>(this)->get_ptr(key); }
+
+    /// Replace all elements by sorted unique keys and their values in O(n)
+    void build_sorted(span<const K> keys, span<const V> values)
+    {
+        CXXASSERT(keys.size() == values.size());
+        this->build(keys.size(), [&](typename Parent::leaf_t *leaf, size_t slot, size_t index) {
+            const K *src = keys.get();
+            CXXASSERT_MSG(index == 0 || this->compare_(src[index - 1], src[index]), "keys are not sorted");
+            new (&leaf->keys()[slot]) K(src[index]);
+            new (&leaf->values()[slot]) V(values.get()[index]);
+        });
+    }
+};
+
+template <typename K, typename Compare = std::less<K>, size_t NODE_BYTES = 256>
+class btree_set : public base_btree<K, void, Compare, NODE_BYTES>
+{
+    using Parent = base_btree<K, void, Compare, NODE_BYTES>;
+
+  public:
+    using Parent::Parent;
+    using typename Parent::iterator;
+
+    /// \return The element with key, and whether it was inserted
+    std::pair<iterator, bool> insert(const K &key) { return this->insert_key(key); }
+
+    /// Replace all elements by sorted unique keys in O(n)
+    void build_sorted(span<const K> keys)
+    {
+        this->build(keys.size(), [&](typename Parent::leaf_t *leaf, size_t slot, size_t index) {
+            const K *src = keys.get();
+            CXXASSERT_MSG(index == 0 || this->compare_(src[index - 1], src[index]), "keys are not sorted");
+            new (&leaf->keys()[slot]) K(src[index]);
+        });
+    }
+};
+
+} // namespace freelibcxx
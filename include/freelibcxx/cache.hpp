@@ -0,0 +1,608 @@
+#pragma once
+#include "freelibcxx/algorithm.hpp"
+#include "freelibcxx/allocator.hpp"
+#include "freelibcxx/assert.hpp"
+#include "freelibcxx/delegate.hpp"
+#include "freelibcxx/function_ref.hpp"
+#include "freelibcxx/hash.hpp"
+#include "freelibcxx/optional.hpp"
+#include "freelibcxx/utils.hpp"
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace freelibcxx
+{
+namespace detail
+{
+/// Hash chains over nodes owned by a cache.
+/// A node N has the fields hnext, hash and key.
+template <typename N, typename K, typename hash_func> class cache_index
+{
+  public:
+    cache_index(Allocator *allocator, size_t capacity)
+        : cap_(next_pow_of_2(max(capacity, (size_t)2)))
+        , buckets_(allocator->NewArray<N *>(cap_, nullptr))
+    {
+    }
+
+    void destroy(Allocator *allocator) { allocator->DeleteArray(cap_, buckets_); }
+
+    N *find(const K &key, size_t hash) const
+    {
+        for (N *node = buckets_[hash & (cap_ - 1)]; node != nullptr; node = node->hnext)
+        {
+            if (node->hash == hash && node->key == key)
+            {
+                return node;
+            }
+        }
+        return nullptr;
+    }
+
+    void link(N *node)
+    {
+        N *&head = buckets_[node->hash & (cap_ - 1)];
+        node->hnext = head;
+        head = node;
+    }
+
+    void unlink(N *node)
+    {
+        N **prev = &buckets_[node->hash & (cap_ - 1)];
+        while (*prev != node)
+        {
+            prev = &(*prev)->hnext;
+        }
+        *prev = node->hnext;
+    }
+
+    void clear()
+    {
+        for (size_t i = 0; i < cap_; i++)
+        {
+            buckets_[i] = nullptr;
+        }
+    }
+
+  private:
+    size_t cap_;
+    N **buckets_;
+};
+} // namespace detail
+
+/// A least recently used cache with bounded capacity.
+/// The hash chain and the recency list are linked through the same node,
+/// a hit is one lookup and a relink, an entry is one allocation.
+/// Once the cache is full the node of the evicted entry is reused.
+template <typename K, typename V, typename hash_func = hasher<K>> class lru_cache
+{
+    struct node_t
+    {
+        node_t *prev;
+        node_t *next;
+        node_t *hnext;
+        size_t hash;
+        K key;
+        V value;
+        template <typename... Args>
+        node_t(size_t hash, const K &key, Args &&...args)
+            : prev(nullptr)
+            , next(nullptr)
+            , hnext(nullptr)
+            , hash(hash)
+            , key(key)
+            , value(std::forward<Args>(args)...)
+        {
+        }
+    };
+
+    struct list_head
+    {
+        node_t *prev;
+        node_t *next;
+    };
+
+  public:
+    /// Called with an entry which is evicted for room, before it is destroyed
+    using evict_callback = delegate<void(const K &, V &)>;
+
+    /// \param capacity The maximum count of entries
+    /// \param on_evict Called for entries evicted by capacity
+    lru_cache(Allocator *allocator, size_t capacity, evict_callback on_evict = nullptr)
+        : allocator_(allocator)
+        , index_(allocator, capacity)
+        , capacity_(capacity)
+        , size_(0)
+        , on_evict_(on_evict)
+    {
+        CXXASSERT(capacity > 0);
+        head_.prev = head_.next = sentinel();
+    }
+
+    lru_cache(const lru_cache &) = delete;
+    lru_cache &operator=(const lru_cache &) = delete;
+
+    ~lru_cache()
+    {
+        clear();
+        index_.destroy(allocator_);
+    }
+
+    /// Look up key and mark it most recently used
+    ///
+    /// \return The value, valid until the entry is evicted or removed
+    V *get(const K &key)
+    {
+        node_t *node = index_.find(key, hash_func()(key));
+        if (node == nullptr)
+        {
+            return nullptr;
+        }
+        unlink_list(node);
+        push_front(node);
+        return &node->value;
+    }
+
+    /// Look up key without touching the recency
+    V *peek(const K &key) const
+    {
+        node_t *node = index_.find(key, hash_func()(key));
+        return node != nullptr ? &node->value : nullptr;
+    }
+
+    bool has(const K &key) const { return peek(key) != nullptr; }
+
+    /// Insert or assign key, it becomes the most recently used.
+    /// The least recently used entry is evicted if the cache is full.
+    template <typename... Args> V *put(const K &key, Args &&...args)
+    {
+        size_t hash = hash_func()(key);
+        node_t *node = index_.find(key, hash);
+        if (node != nullptr)
+        {
+            node->value = V(std::forward<Args>(args)...);
+            unlink_list(node);
+            push_front(node);
+            return &node->value;
+        }
+        return emplace(hash, key, std::forward<Args>(args)...);
+    }
+
+    /// Look up key, on a miss load the value and insert it
+    ///
+    /// \param loader Returns the value of key, or nullopt if it does not exist
+    /// \return The value, or nullptr if loader failed
+    V *get_or_load(const K &key, function_ref<optional<V>(const K &)> loader)
+    {
+        size_t hash = hash_func()(key);
+        node_t *node = index_.find(key, hash);
+        if (node != nullptr)
+        {
+            unlink_list(node);
+            push_front(node);
+            return &node->value;
+        }
+        optional<V> value = loader(key);
+        if (!value.has_value())
+        {
+            return nullptr;
+        }
+        return emplace(hash, key, std::move(value.value()));
+    }
+
+    /// Remove key, the evict callback is not called
+    bool remove(const K &key)
+    {
+        node_t *node = index_.find(key, hash_func()(key));
+        if (node == nullptr)
+        {
+            return false;
+        }
+        index_.unlink(node);
+        unlink_list(node);
+        allocator_->Delete(node);
+        size_--;
+        return true;
+    }
+
+    void clear()
+    {
+        for (node_t *node = head_.next; node != sentinel();)
+        {
+            node_t *next = node->next;
+            allocator_->Delete(node);
+            node = next;
+        }
+        head_.prev = head_.next = sentinel();
+        index_.clear();
+        size_ = 0;
+    }
+
+    /// Visit entries from the most recently used
+    void for_each(function_ref<void(const K &, V &)> fn)
+    {
+        for (node_t *node = head_.next; node != sentinel(); node = node->next)
+        {
+            fn(node->key, node->value);
+        }
+    }
+
+    void set_evict_callback(evict_callback on_evict) { on_evict_ = on_evict; }
+
+    size_t size() const { return size_; }
+
+    size_t capacity() const { return capacity_; }
+
+  private:
+    Allocator *allocator_;
+    detail::cache_index<node_t, K, hash_func> index_;
+    list_head head_;
+    size_t capacity_;
+    size_t size_;
+    evict_callback on_evict_;
+
+    // head_ acts as a node in the list, only prev and next are touched
+    node_t *sentinel() { return (node_t *)&head_; }
+
+    void push_front(node_t *node)
+    {
+        node->prev = sentinel();
+        node->next = head_.next;
+        head_.next->prev = node;
+        head_.next = node;
+    }
+
+    static void unlink_list(node_t *node)
+    {
+        node->prev->next = node->next;
+        node->next->prev = node->prev;
+    }
+
+    template <typename... Args> V *emplace(size_t hash, const K &key, Args &&...args)
+    {
+        node_t *node;
+        if (size_ >= capacity_)
+        {
+            // args may refer to the evicted value, build the new one before it goes
+            V value(std::forward<Args>(args)...);
+            node = head_.prev;
+            if (on_evict_)
+            {
+                on_evict_(node->key, node->value);
+            }
+            index_.unlink(node);
+            unlink_list(node);
+            node->hash = hash;
+            node->key = key;
+            node->value = std::move(value);
+        }
+        else
+        {
+            node = allocator_->New<node_t>(hash, key, std::forward<Args>(args)...);
+            size_++;
+        }
+        index_.link(node);
+        push_front(node);
+        return &node->value;
+    }
+};
+
+/// A CLOCK cache with bounded capacity, an approximation of LRU.
+/// A hit only sets a referenced bit, eviction sweeps a hand over the slots and
+/// takes the first entry not referenced since the last sweep. Slots are one
+/// array allocated with the cache.
+template <typename K, typename V, typename hash_func = hasher<K>> class clock_cache
+{
+    struct node_t
+    {
+        node_t *hnext;
+        size_t hash;
+        bool referenced;
+        K key;
+        V value;
+        template <typename... Args>
+        node_t(size_t hash, const K &key, Args &&...args)
+            : hnext(nullptr)
+            , hash(hash)
+            , referenced(false)
+            , key(key)
+            , value(std::forward<Args>(args)...)
+        {
+        }
+    };
+
+  public:
+    /// Called with an entry which is evicted for room, before it is destroyed
+    using evict_callback = delegate<void(const K &, V &)>;
+
+    /// \param capacity The maximum count of entries
+    /// \param on_evict Called for entries evicted by capacity
+    clock_cache(Allocator *allocator, size_t capacity, evict_callback on_evict = nullptr)
+        : allocator_(allocator)
+        , index_(allocator, capacity)
+        , slots_((node_t *)allocator->allocate(capacity * sizeof(node_t), alignof(node_t)))
+        , used_(allocator->NewArray<bool>(capacity, false))
+        , capacity_(capacity)
+        , size_(0)
+        , hand_(0)
+        , on_evict_(on_evict)
+    {
+        CXXASSERT(capacity > 0);
+    }
+
+    clock_cache(const clock_cache &) = delete;
+    clock_cache &operator=(const clock_cache &) = delete;
+
+    ~clock_cache()
+    {
+        clear();
+        index_.destroy(allocator_);
+        allocator_->deallocate(slots_);
+        allocator_->DeleteArray(capacity_, used_);
+    }
+
+    /// Look up key and mark it referenced
+    ///
+    /// \return The value, valid until the entry is evicted or removed
+    V *get(const K &key)
+    {
+        node_t *node = index_.find(key, hash_func()(key));
+        if (node == nullptr)
+        {
+            return nullptr;
+        }
+        node->referenced = true;
+        return &node->value;
+    }
+
+    /// Look up key without marking it
+    V *peek(const K &key) const
+    {
+        node_t *node = index_.find(key, hash_func()(key));
+        return node != nullptr ? &node->value : nullptr;
+    }
+
+    bool has(const K &key) const { return peek(key) != nullptr; }
+
+    /// Insert or assign key. An entry is evicted if the cache is full.
+    template <typename... Args> V *put(const K &key, Args &&...args)
+    {
+        size_t hash = hash_func()(key);
+        node_t *node = index_.find(key, hash);
+        if (node != nullptr)
+        {
+            node->value = V(std::forward<Args>(args)...);
+            node->referenced = true;
+            return &node->value;
+        }
+        return emplace(hash, key, std::forward<Args>(args)...);
+    }
+
+    /// Look up key, on a miss load the value and insert it
+    ///
+    /// \param loader Returns the value of key, or nullopt if it does not exist
+    /// \return The value, or nullptr if loader failed
+    V *get_or_load(const K &key, function_ref<optional<V>(const K &)> loader)
+    {
+        size_t hash = hash_func()(key);
+        node_t *node = index_.find(key, hash);
+        if (node != nullptr)
+        {
+            node->referenced = true;
+            return &node->value;
+        }
+        optional<V> value = loader(key);
+        if (!value.has_value())
+        {
+            return nullptr;
+        }
+        return emplace(hash, key, std::move(value.value()));
+    }
+
+    /// Remove key, the evict callback is not called
+    bool remove(const K &key)
+    {
+        node_t *node = index_.find(key, hash_func()(key));
+        if (node == nullptr)
+        {
+            return false;
+        }
+        release(node);
+        return true;
+    }
+
+    void clear()
+    {
+        for (size_t i = 0; i < capacity_; i++)
+        {
+            if (used_[i])
+            {
+                slots_[i].~node_t();
+                used_[i] = false;
+            }
+        }
+        index_.clear();
+        size_ = 0;
+    }
+
+    void set_evict_callback(evict_callback on_evict) { on_evict_ = on_evict; }
+
+    size_t size() const { return size_; }
+
+    size_t capacity() const { return capacity_; }
+
+  private:
+    Allocator *allocator_;
+    detail::cache_index<node_t, K, hash_func> index_;
+    node_t *slots_;
+    bool *used_;
+    size_t capacity_;
+    size_t size_;
+    size_t hand_;
+    evict_callback on_evict_;
+
+    void release(node_t *node)
+    {
+        index_.unlink(node);
+        node->~node_t();
+        used_[node - slots_] = false;
+        size_--;
+    }
+
+    // advance the hand to a free slot, evicting the first entry not referenced
+    size_t sweep()
+    {
+        for (;;)
+        {
+            size_t slot = hand_;
+            hand_ = hand_ + 1 == capacity_ ? 0 : hand_ + 1;
+            if (!used_[slot])
+            {
+                return slot;
+            }
+            node_t *node = &slots_[slot];
+            if (node->referenced)
+            {
+                node->referenced = false;
+                continue;
+            }
+            if (on_evict_)
+            {
+                on_evict_(node->key, node->value);
+            }
+            release(node);
+            return slot;
+        }
+    }
+
+    template <typename... Args> V *emplace(size_t hash, const K &key, Args &&...args)
+    {
+        // args may refer to the value sweep evicts, build the new one first
+        V value(std::forward<Args>(args)...);
+        size_t slot = sweep();
+        node_t *node = new (&slots_[slot]) node_t(hash, key, std::move(value));
+        used_[slot] = true;
+        size_++;
+        index_.link(node);
+        return &node->value;
+    }
+};
+
+/// A cache split in SHARDS caches by key hash, each behind a spin lock.
+/// Values are copied out since an entry may be evicted once the lock is released.
+///
+/// sharded_cache<lru_cache<int, inode_info>> cache(allocator, 4096);
+template <typename Cache, size_t SHARDS = 16> class sharded_cache
+{
+    static_assert(is_pow_of_2(SHARDS));
+
+    template <typename C> struct cache_traits;
+    template <template <typename, typename, typename> typename C, typename K, typename V, typename H>
+    struct cache_traits<C<K, V, H>>
+    {
+        using key_type = K;
+        using value_type = V;
+        using hash_type = H;
+    };
+
+    using K = typename cache_traits<Cache>::key_type;
+    using V = typename cache_traits<Cache>::value_type;
+    using hash_func = typename cache_traits<Cache>::hash_type;
+
+    // a line per shard, so shards do not contend through their lock or cache header
+    struct alignas(64) shard_t
+    {
+        Cache cache;
+        std::atomic<bool> locked;
+        shard_t(Allocator *allocator, size_t capacity, typename Cache::evict_callback on_evict)
+            : cache(allocator, capacity, on_evict)
+            , locked(false)
+        {
+        }
+    };
+
+  public:
+    /// \param capacity The maximum count of entries over all shards
+    /// \param on_evict Called for entries evicted by capacity, under the shard lock
+    sharded_cache(Allocator *allocator, size_t capacity, typename Cache::evict_callback on_evict = nullptr)
+        : allocator_(allocator)
+        , shards_(allocator->NewArray<shard_t>(SHARDS, allocator, max(capacity / SHARDS, (size_t)1), on_evict))
+    {
+    }
+
+    sharded_cache(const sharded_cache &) = delete;
+    sharded_cache &operator=(const sharded_cache &) = delete;
+
+    ~sharded_cache() { allocator_->DeleteArray(SHARDS, shards_); }
+
+    optional<V> get(const K &key)
+    {
+        shard_t &shard = shard_of(key);
+        lock(shard);
+        V *value = shard.cache.get(key);
+        optional<V> result = value != nullptr ? optional<V>(*value) : nullopt;
+        unlock(shard);
+        return result;
+    }
+
+    template <typename... Args> void put(const K &key, Args &&...args)
+    {
+        shard_t &shard = shard_of(key);
+        lock(shard);
+        shard.cache.put(key, std::forward<Args>(args)...);
+        unlock(shard);
+    }
+
+    /// The loader runs under the shard lock, so a key is loaded once
+    optional<V> get_or_load(const K &key, function_ref<optional<V>(const K &)> loader)
+    {
+        shard_t &shard = shard_of(key);
+        lock(shard);
+        V *value = shard.cache.get_or_load(key, loader);
+        optional<V> result = value != nullptr ? optional<V>(*value) : nullopt;
+        unlock(shard);
+        return result;
+    }
+
+    bool remove(const K &key)
+    {
+        shard_t &shard = shard_of(key);
+        lock(shard);
+        bool removed = shard.cache.remove(key);
+        unlock(shard);
+        return removed;
+    }
+
+    size_t size()
+    {
+        size_t size = 0;
+        for (size_t i = 0; i < SHARDS; i++)
+        {
+            lock(shards_[i]);
+            size += shards_[i].cache.size();
+            unlock(shards_[i]);
+        }
+        return size;
+    }
+
+  private:
+    Allocator *allocator_;
+    shard_t *shards_;
+
+    // the high bits pick the shard, the low bits pick buckets inside it
+    shard_t &shard_of(const K &key) { return shards_[(hash_func()(key) >> 32) & (SHARDS - 1)]; }
+
+    static void lock(shard_t &shard)
+    {
+        while (shard.locked.exchange(true, std::memory_order_acquire))
+        {
+            while (shard.locked.load(std::memory_order_relaxed))
+                detail::cpu_relax();
+        }
+    }
+
+    static void unlock(shard_t &shard) { shard.locked.store(false, std::memory_order_release); }
+};
+
+} // namespace freelibcxx
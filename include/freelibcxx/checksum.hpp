@@ -0,0 +1,341 @@
+#pragma once
+#include "freelibcxx/hash.hpp"
+#include "freelibcxx/span.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace freelibcxx
+{
+namespace detail
+{
+
+//-----------------------------------------------------------------------------
+// CRC-32C (Castagnoli), reflected polynomial.
+// The hardware path follows crc32c.c by Mark Adler: three streams are computed
+// in parallel by the SSE4.2 crc32 instruction, and merged by table driven
+// shifts. Without SSE4.2 a slicing-by-8 table is used.
+
+constexpr uint32_t crc32c_poly = 0x82f63b78;
+
+// buffer lengths of the three parallel streams, must be power of 2
+constexpr size_t crc32c_long = 8192;
+constexpr size_t crc32c_short = 256;
+
+constexpr uint32_t gf2_matrix_times(const uint32_t *mat, uint32_t vec)
+{
+    uint32_t sum = 0;
+    while (vec)
+    {
+        if (vec & 1)
+            sum ^= *mat;
+        vec >>= 1;
+        mat++;
+    }
+    return sum;
+}
+
+constexpr void gf2_matrix_square(uint32_t *square, const uint32_t *mat)
+{
+    for (int n = 0; n < 32; n++)
+    {
+        square[n] = gf2_matrix_times(mat, mat[n]);
+    }
+}
+
+// operator for one zero bit in odd, and two zero bits in even
+constexpr void crc32c_zeros_init(uint32_t *even, uint32_t *odd)
+{
+    odd[0] = crc32c_poly;
+    uint32_t row = 1;
+    for (int n = 1; n < 32; n++)
+    {
+        odd[n] = row;
+        row <<= 1;
+    }
+    gf2_matrix_square(even, odd);
+}
+
+struct crc32c_table_t
+{
+    uint32_t slice[8][256];
+#if defined(__SSE4_2__)
+    uint32_t long_shift[4][256];
+    uint32_t short_shift[4][256];
+#endif
+};
+
+// operator which appends len zero bytes, len is power of 2
+constexpr void crc32c_zeros_op(uint32_t *even, size_t len)
+{
+    uint32_t odd[32] = {};
+    crc32c_zeros_init(even, odd);
+    gf2_matrix_square(odd, even);
+    do
+    {
+        gf2_matrix_square(even, odd);
+        len >>= 1;
+        if (len == 0)
+            return;
+        gf2_matrix_square(odd, even);
+        len >>= 1;
+    } while (len);
+    for (int n = 0; n < 32; n++)
+    {
+        even[n] = odd[n];
+    }
+}
+
+constexpr void crc32c_zeros(uint32_t (&zeros)[4][256], size_t len)
+{
+    uint32_t op[32] = {};
+    crc32c_zeros_op(op, len);
+    for (uint32_t n = 0; n < 256; n++)
+    {
+        zeros[0][n] = gf2_matrix_times(op, n);
+        zeros[1][n] = gf2_matrix_times(op, n << 8);
+        zeros[2][n] = gf2_matrix_times(op, n << 16);
+        zeros[3][n] = gf2_matrix_times(op, n << 24);
+    }
+}
+
+constexpr crc32c_table_t make_crc32c_table()
+{
+    crc32c_table_t table = {};
+    for (uint32_t n = 0; n < 256; n++)
+    {
+        uint32_t crc = n;
+        for (int k = 0; k < 8; k++)
+        {
+            crc = crc & 1 ? (crc >> 1) ^ crc32c_poly : crc >> 1;
+        }
+        table.slice[0][n] = crc;
+    }
+    for (uint32_t n = 0; n < 256; n++)
+    {
+        uint32_t crc = table.slice[0][n];
+        for (int k = 1; k < 8; k++)
+        {
+            crc = table.slice[0][crc & 0xff] ^ (crc >> 8);
+            table.slice[k][n] = crc;
+        }
+    }
+#if defined(__SSE4_2__)
+    crc32c_zeros(table.long_shift, crc32c_long);
+    crc32c_zeros(table.short_shift, crc32c_short);
+#endif
+    return table;
+}
+
+inline constexpr crc32c_table_t crc32c_table = make_crc32c_table();
+
+// raw crc, without pre and post conditioning
+inline uint32_t crc32c_sw(uint32_t crc, const uint8_t *p, size_t len)
+{
+    const auto &t = crc32c_table.slice;
+    while (len && ((uintptr_t)p & 7) != 0)
+    {
+        crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+        len--;
+    }
+    while (len >= 8)
+    {
+        uint64_t word = read64(p) ^ crc;
+        crc = t[7][word & 0xff] ^ t[6][(word >> 8) & 0xff] ^ t[5][(word >> 16) & 0xff] ^ t[4][(word >> 24) & 0xff] ^
+              t[3][(word >> 32) & 0xff] ^ t[2][(word >> 40) & 0xff] ^ t[1][(word >> 48) & 0xff] ^ t[0][word >> 56];
+        p += 8;
+        len -= 8;
+    }
+    while (len)
+    {
+        crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+        len--;
+    }
+    return crc;
+}
+
+#if defined(__SSE4_2__)
+inline uint32_t crc32c_shift(const uint32_t (&zeros)[4][256], uint32_t crc)
+{
+    return zeros[0][crc & 0xff] ^ zeros[1][(crc >> 8) & 0xff] ^ zeros[2][(crc >> 16) & 0xff] ^ zeros[3][crc >> 24];
+}
+
+// raw crc, without pre and post conditioning
+inline uint32_t crc32c_hw(uint32_t crc, const uint8_t *p, size_t len)
+{
+    uint64_t crc0 = crc;
+    while (len && ((uintptr_t)p & 7) != 0)
+    {
+        crc0 = __builtin_ia32_crc32qi(crc0, *p++);
+        len--;
+    }
+    // three streams hide the latency of the crc32 instruction
+    while (len >= crc32c_long * 3)
+    {
+        uint64_t crc1 = 0;
+        uint64_t crc2 = 0;
+        const uint8_t *end = p + crc32c_long;
+        do
+        {
+            crc0 = __builtin_ia32_crc32di(crc0, read64(p));
+            crc1 = __builtin_ia32_crc32di(crc1, read64(p + crc32c_long));
+            crc2 = __builtin_ia32_crc32di(crc2, read64(p + crc32c_long * 2));
+            p += 8;
+        } while (p < end);
+        crc0 = crc32c_shift(crc32c_table.long_shift, crc0) ^ crc1;
+        crc0 = crc32c_shift(crc32c_table.long_shift, crc0) ^ crc2;
+        p += crc32c_long * 2;
+        len -= crc32c_long * 3;
+    }
+    while (len >= crc32c_short * 3)
+    {
+        uint64_t crc1 = 0;
+        uint64_t crc2 = 0;
+        const uint8_t *end = p + crc32c_short;
+        do
+        {
+            crc0 = __builtin_ia32_crc32di(crc0, read64(p));
+            crc1 = __builtin_ia32_crc32di(crc1, read64(p + crc32c_short));
+            crc2 = __builtin_ia32_crc32di(crc2, read64(p + crc32c_short * 2));
+            p += 8;
+        } while (p < end);
+        crc0 = crc32c_shift(crc32c_table.short_shift, crc0) ^ crc1;
+        crc0 = crc32c_shift(crc32c_table.short_shift, crc0) ^ crc2;
+        p += crc32c_short * 2;
+        len -= crc32c_short * 3;
+    }
+    while (len >= 8)
+    {
+        crc0 = __builtin_ia32_crc32di(crc0, read64(p));
+        p += 8;
+        len -= 8;
+    }
+    while (len)
+    {
+        crc0 = __builtin_ia32_crc32qi(crc0, *p++);
+        len--;
+    }
+    return crc0;
+}
+#endif
+
+// Adler-32 defers the modulo for as many bytes as cannot overflow 32 bits
+constexpr uint32_t adler32_base = 65521;
+constexpr size_t adler32_nmax = 5552;
+
+} // namespace detail
+
+/// Update a CRC-32C with data. Start with crc = 0.
+/// Uses the SSE4.2 crc32 instruction when the library is built with it.
+inline uint32_t crc32c(uint32_t crc, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+#if defined(__SSE4_2__)
+    return ~detail::crc32c_hw(~crc, p, len);
+#else
+    return ~detail::crc32c_sw(~crc, p, len);
+#endif
+}
+
+inline uint32_t crc32c(uint32_t crc, span<const std::byte> bytes) { return crc32c(crc, bytes.get(), bytes.size()); }
+
+/// CRC-32C of a concatenation of two buffers
+///
+/// \param crc1 CRC-32C of the first buffer
+/// \param crc2 CRC-32C of the second buffer
+/// \param len2 Length of the second buffer
+inline uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, size_t len2)
+{
+    if (len2 == 0)
+    {
+        return crc1;
+    }
+    uint32_t even[32];
+    uint32_t odd[32];
+    detail::crc32c_zeros_init(even, odd);
+    detail::gf2_matrix_square(odd, even);
+    do
+    {
+        detail::gf2_matrix_square(even, odd);
+        if (len2 & 1)
+            crc1 = detail::gf2_matrix_times(even, crc1);
+        len2 >>= 1;
+        if (len2 == 0)
+            break;
+        detail::gf2_matrix_square(odd, even);
+        if (len2 & 1)
+            crc1 = detail::gf2_matrix_times(odd, crc1);
+        len2 >>= 1;
+    } while (len2 != 0);
+    return crc1 ^ crc2;
+}
+
+/// Update an Adler-32 with data. Start with adler = 1.
+inline uint32_t adler32(uint32_t adler, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    uint32_t a = adler & 0xffff;
+    uint32_t b = adler >> 16;
+    while (len > 0)
+    {
+        size_t n = min(len, detail::adler32_nmax);
+        len -= n;
+        while (n >= 8)
+        {
+            a += p[0];
+            b += a;
+            a += p[1];
+            b += a;
+            a += p[2];
+            b += a;
+            a += p[3];
+            b += a;
+            a += p[4];
+            b += a;
+            a += p[5];
+            b += a;
+            a += p[6];
+            b += a;
+            a += p[7];
+            b += a;
+            p += 8;
+            n -= 8;
+        }
+        while (n > 0)
+        {
+            a += *p++;
+            b += a;
+            n--;
+        }
+        a %= detail::adler32_base;
+        b %= detail::adler32_base;
+    }
+    return (b << 16) | a;
+}
+
+inline uint32_t adler32(uint32_t adler, span<const std::byte> bytes) { return adler32(adler, bytes.get(), bytes.size()); }
+
+/// Adler-32 of a concatenation of two buffers
+///
+/// \param adler1 Adler-32 of the first buffer
+/// \param adler2 Adler-32 of the second buffer
+/// \param len2 Length of the second buffer
+inline uint32_t adler32_combine(uint32_t adler1, uint32_t adler2, size_t len2)
+{
+    const uint32_t base = detail::adler32_base;
+    uint32_t rem = len2 % base;
+    uint32_t sum1 = adler1 & 0xffff;
+    uint32_t sum2 = (uint32_t)(((uint64_t)rem * sum1) % base);
+    sum1 += (adler2 & 0xffff) + base - 1;
+    sum2 += (adler1 >> 16) + (adler2 >> 16) + base - rem;
+    if (sum1 >= base)
+        sum1 -= base;
+    if (sum1 >= base)
+        sum1 -= base;
+    if (sum2 >= ((uint32_t)base << 1))
+        sum2 -= ((uint32_t)base << 1);
+    if (sum2 >= base)
+        sum2 -= base;
+    return sum1 | (sum2 << 16);
+}
+
+} // namespace freelibcxx
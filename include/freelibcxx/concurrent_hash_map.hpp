@@ -0,0 +1,329 @@
+#pragma once
+#include "freelibcxx/algorithm.hpp"
+#include "freelibcxx/allocator.hpp"
+#include "freelibcxx/hash.hpp"
+#include "freelibcxx/optional.hpp"
+#include "freelibcxx/utils.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace freelibcxx
+{
+/// A hash map for SMP.
+/// Writers take a spin lock of the stripe which the key belongs to.
+/// Readers never lock: every stripe has a sequence counter, a reader retries
+/// when a writer touched the stripe while it was reading.
+///
+/// Nodes removed are kept in a free list of their stripe and old tables are kept
+/// until the map is destroyed, so readers never touch returned memory.
+/// K and V are copied out by readers, they must be trivially copyable.
+template <typename K, typename V, typename hash_func = hasher<K>, size_t STRIPES = 16> class concurrent_hash_map
+{
+    static_assert(std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<V>);
+    static_assert(is_pow_of_2(STRIPES));
+
+    struct node_t
+    {
+        K key;
+        V value;
+        std::atomic<node_t *> next;
+    };
+
+    struct table_t
+    {
+        table_t *retired;
+        size_t cap;
+        std::atomic<node_t *> buckets[0];
+    };
+
+    struct alignas(64) stripe_t
+    {
+        std::atomic<uint32_t> seq;
+        std::atomic<bool> locked;
+        node_t *free;
+    };
+
+  public:
+    explicit concurrent_hash_map(Allocator *allocator, size_t capacity = 0)
+        : allocator_(allocator)
+        , size_(0)
+    {
+        for (size_t i = 0; i < STRIPES; i++)
+        {
+            stripes_[i].seq.store(0, std::memory_order_relaxed);
+            stripes_[i].locked.store(false, std::memory_order_relaxed);
+            stripes_[i].free = nullptr;
+        }
+        table_.store(make_table(table_capacity(capacity), nullptr), std::memory_order_release);
+    }
+
+    concurrent_hash_map(const concurrent_hash_map &) = delete;
+    concurrent_hash_map &operator=(const concurrent_hash_map &) = delete;
+
+    ~concurrent_hash_map() { free(); }
+
+    /// Insert key only if it is absent
+    ///
+    /// \return true if inserted
+    bool insert(const K &key, const V &value) { return put(key, value, false); }
+
+    /// Insert key, or overwrite the value of the existing key
+    ///
+    /// \return true if inserted
+    bool insert_or_assign(const K &key, const V &value) { return put(key, value, true); }
+
+    bool remove(const K &key)
+    {
+        size_t hash = hash_func()(key);
+        stripe_t &stripe = stripes_[hash & (STRIPES - 1)];
+        lock(stripe);
+        table_t *table = table_.load(std::memory_order_relaxed);
+        auto *prev = &table->buckets[hash & (table->cap - 1)];
+        for (node_t *node = prev->load(std::memory_order_relaxed); node != nullptr;
+             node = node->next.load(std::memory_order_relaxed))
+        {
+            if (node->key == key)
+            {
+                write_begin(stripe);
+                prev->store(node->next.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                write_end(stripe);
+                node->next.store(stripe.free, std::memory_order_relaxed);
+                stripe.free = node;
+                size_.fetch_sub(1, std::memory_order_relaxed);
+                unlock(stripe);
+                return true;
+            }
+            prev = &node->next;
+        }
+        unlock(stripe);
+        return false;
+    }
+
+    /// Lock-free lookup
+    optional<V> get(const K &key) const
+    {
+        size_t hash = hash_func()(key);
+        const stripe_t &stripe = stripes_[hash & (STRIPES - 1)];
+        for (;;)
+        {
+            uint32_t seq = read_begin(stripe);
+            table_t *table = table_.load(std::memory_order_acquire);
+            node_t *node = table->buckets[hash & (table->cap - 1)].load(std::memory_order_acquire);
+            bool retry = false;
+            while (node != nullptr)
+            {
+                K k = node->key;
+                V v = node->value;
+                node_t *next = node->next.load(std::memory_order_acquire);
+                if (!read_valid(stripe, seq))
+                {
+                    retry = true;
+                    break;
+                }
+                if (k == key)
+                {
+                    return v;
+                }
+                node = next;
+            }
+            if (!retry && read_valid(stripe, seq))
+            {
+                return nullopt;
+            }
+        }
+    }
+
+    bool has(const K &key) const { return get(key).has_value(); }
+
+    size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+    size_t capacity() const { return table_.load(std::memory_order_acquire)->cap; }
+
+  private:
+    Allocator *allocator_;
+    std::atomic<table_t *> table_;
+    std::atomic<size_t> size_;
+    stripe_t stripes_[STRIPES];
+
+    static size_t table_capacity(size_t element_count)
+    {
+        return max(STRIPES, next_pow_of_2(element_count * 4 / 3 + 1));
+    }
+
+    table_t *make_table(size_t cap, table_t *retired)
+    {
+        void *p = allocator_->allocate(sizeof(table_t) + cap * sizeof(std::atomic<node_t *>), alignof(table_t));
+        table_t *table = new (p) table_t();
+        table->retired = retired;
+        table->cap = cap;
+        for (size_t i = 0; i < cap; i++)
+        {
+            new (&table->buckets[i]) std::atomic<node_t *>(nullptr);
+        }
+        return table;
+    }
+
+    static void lock(stripe_t &stripe)
+    {
+        while (stripe.locked.exchange(true, std::memory_order_acquire))
+        {
+            while (stripe.locked.load(std::memory_order_relaxed))
+                detail::cpu_relax();
+        }
+    }
+
+    static void unlock(stripe_t &stripe) { stripe.locked.store(false, std::memory_order_release); }
+
+    static void write_begin(stripe_t &stripe)
+    {
+        stripe.seq.store(stripe.seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    static void write_end(stripe_t &stripe)
+    {
+        stripe.seq.store(stripe.seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    static uint32_t read_begin(const stripe_t &stripe)
+    {
+        for (;;)
+        {
+            uint32_t seq = stripe.seq.load(std::memory_order_acquire);
+            if ((seq & 1) == 0) [[likely]]
+                return seq;
+            detail::cpu_relax();
+        }
+    }
+
+    static bool read_valid(const stripe_t &stripe, uint32_t seq)
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return stripe.seq.load(std::memory_order_relaxed) == seq;
+    }
+
+    bool put(const K &key, const V &value, bool assign)
+    {
+        size_t hash = hash_func()(key);
+        if (size() + 1 > table_.load(std::memory_order_relaxed)->cap * 75 / 100) [[unlikely]]
+        {
+            grow();
+        }
+        stripe_t &stripe = stripes_[hash & (STRIPES - 1)];
+        lock(stripe);
+        table_t *table = table_.load(std::memory_order_relaxed);
+        auto &bucket = table->buckets[hash & (table->cap - 1)];
+        for (node_t *node = bucket.load(std::memory_order_relaxed); node != nullptr;
+             node = node->next.load(std::memory_order_relaxed))
+        {
+            if (node->key == key)
+            {
+                if (assign)
+                {
+                    write_begin(stripe);
+                    node->value = value;
+                    write_end(stripe);
+                }
+                unlock(stripe);
+                return false;
+            }
+        }
+
+        node_t *node = stripe.free;
+        write_begin(stripe);
+        if (node != nullptr)
+        {
+            stripe.free = node->next.load(std::memory_order_relaxed);
+            node->key = key;
+            node->value = value;
+        }
+        else
+        {
+            node = allocator_->New<node_t>(key, value, nullptr);
+        }
+        node->next.store(bucket.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        bucket.store(node, std::memory_order_relaxed);
+        write_end(stripe);
+        size_.fetch_add(1, std::memory_order_relaxed);
+        unlock(stripe);
+        return true;
+    }
+
+    // take all stripes, relink every node into a table twice as large
+    void grow()
+    {
+        for (size_t i = 0; i < STRIPES; i++)
+        {
+            lock(stripes_[i]);
+        }
+        table_t *old = table_.load(std::memory_order_relaxed);
+        if (size() + 1 > old->cap * 75 / 100)
+        {
+            for (size_t i = 0; i < STRIPES; i++)
+            {
+                write_begin(stripes_[i]);
+            }
+            table_t *table = make_table(old->cap * 2, old);
+            for (size_t i = 0; i < old->cap; i++)
+            {
+                node_t *node = old->buckets[i].load(std::memory_order_relaxed);
+                while (node != nullptr)
+                {
+                    node_t *next = node->next.load(std::memory_order_relaxed);
+                    size_t hash = hash_func()(node->key);
+                    auto &bucket = table->buckets[hash & (table->cap - 1)];
+                    node->next.store(bucket.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                    bucket.store(node, std::memory_order_relaxed);
+                    node = next;
+                }
+            }
+            table_.store(table, std::memory_order_release);
+            for (size_t i = 0; i < STRIPES; i++)
+            {
+                write_end(stripes_[i]);
+            }
+        }
+        for (size_t i = STRIPES; i > 0; i--)
+        {
+            unlock(stripes_[i - 1]);
+        }
+    }
+
+    void free() noexcept
+    {
+        table_t *table = table_.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < table->cap; i++)
+        {
+            node_t *node = table->buckets[i].load(std::memory_order_relaxed);
+            while (node != nullptr)
+            {
+                node_t *next = node->next.load(std::memory_order_relaxed);
+                allocator_->Delete(node);
+                node = next;
+            }
+        }
+        for (size_t i = 0; i < STRIPES; i++)
+        {
+            node_t *node = stripes_[i].free;
+            while (node != nullptr)
+            {
+                node_t *next = node->next.load(std::memory_order_relaxed);
+                allocator_->Delete(node);
+                node = next;
+            }
+            stripes_[i].free = nullptr;
+        }
+        while (table != nullptr)
+        {
+            table_t *retired = table->retired;
+            table->~table_t();
+            allocator_->deallocate(table);
+            table = retired;
+        }
+        table_.store(nullptr, std::memory_order_relaxed);
+    }
+};
+
+} // namespace freelibcxx
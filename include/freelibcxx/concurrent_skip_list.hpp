@@ -0,0 +1,520 @@
+#pragma once
+#include "freelibcxx/allocator.hpp"
+#include "freelibcxx/assert.hpp"
+#include "freelibcxx/hash.hpp"
+#include "freelibcxx/optional.hpp"
+#include "freelibcxx/random.hpp"
+#include "freelibcxx/utils.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace freelibcxx
+{
+
+/// A lock-free ordered set for SMP.
+/// Links are changed by CAS. A node is removed logically by marking the low bit
+/// of its next pointers, top level first, then any thread walking past it
+/// unlinks it. Elements are unique, ordered by operator<.
+///
+/// Memory is reclaimed by epochs: every operation pins the global epoch in one
+/// of SLOTS slots, an unlinked node is retired to the list of its epoch and freed
+/// once every pinned operation has moved two epochs further. When all SLOTS
+/// slots are taken an operation joins a shared overflow pin instead of waiting,
+/// which holds the epoch back until the last overflowed operation finishes.
+template <typename E, int MAXLEVEL = 20, size_t SLOTS = 64> class concurrent_skip_list
+{
+    static_assert(MAXLEVEL > 0 && MAXLEVEL <= 64);
+
+    struct node_t
+    {
+        node_t *retired;
+        // the inserting and the removing thread release it, the last one retires
+        std::atomic<int> owners;
+        int level;
+        union
+        {
+            E element;
+        };
+        std::atomic<uintptr_t> next[0];
+
+        node_t(int level)
+            : retired(nullptr)
+            , owners(2)
+            , level(level)
+        {
+            for (int i = 0; i < level; i++)
+            {
+                new (&next[i]) std::atomic<uintptr_t>(0);
+            }
+        }
+        ~node_t() {}
+    };
+
+    // one cache line each, pinning does not contend with the neighbour slots
+    struct alignas(64) slot_t
+    {
+        std::atomic<uint64_t> value;
+    };
+
+    // slot is SLOTS for the overflow pin
+    struct guard_t
+    {
+        size_t slot;
+        uint64_t epoch;
+    };
+
+    static node_t *ptr(uintptr_t link) { return (node_t *)(link & ~(uintptr_t)1); }
+
+    static bool marked(uintptr_t link) { return link & 1; }
+
+  public:
+    explicit concurrent_skip_list(Allocator *allocator)
+        : allocator_(allocator)
+        , head_(make_node(MAXLEVEL))
+        , size_(0)
+        , epoch_(1)
+        , seed_(0)
+    {
+        for (size_t i = 0; i < SLOTS; i++)
+        {
+            slots_[i].value.store(0, std::memory_order_relaxed);
+        }
+        overflow_.store(0, std::memory_order_relaxed);
+        for (int i = 0; i < 3; i++)
+        {
+            limbo_[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    concurrent_skip_list(const concurrent_skip_list &) = delete;
+    concurrent_skip_list &operator=(const concurrent_skip_list &) = delete;
+
+    /// No operation may run while the list is destroyed
+    ~concurrent_skip_list()
+    {
+        node_t *node = ptr(head_->next[0].load(std::memory_order_relaxed));
+        while (node != nullptr)
+        {
+            node_t *next = ptr(node->next[0].load(std::memory_order_relaxed));
+            destroy(node);
+            node = next;
+        }
+        for (int i = 0; i < 3; i++)
+        {
+            free_list(limbo_[i].exchange(nullptr, std::memory_order_relaxed));
+        }
+        head_->~node_t();
+        allocator_->deallocate(head_);
+    }
+
+    /// Insert an element if no equal one exists
+    ///
+    /// \return true if inserted
+    template <typename... Args> bool insert(Args &&...args)
+    {
+        guard_t guard = pin();
+        node_t *node = make_node(random_level(), std::forward<Args>(args)...);
+        node_t *preds[MAXLEVEL];
+        node_t *succs[MAXLEVEL];
+        for (;;)
+        {
+            if (find(node->element, preds, succs))
+            {
+                destroy(node);
+                unpin(guard);
+                return false;
+            }
+            for (int l = 0; l < node->level; l++)
+            {
+                node->next[l].store((uintptr_t)succs[l], std::memory_order_relaxed);
+            }
+            uintptr_t expected = (uintptr_t)succs[0];
+            if (preds[0]->next[0].compare_exchange_strong(expected, (uintptr_t)node, std::memory_order_release,
+                                                          std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        size_.fetch_add(1, std::memory_order_relaxed);
+        link_tower(node, preds, succs);
+        release(node);
+        unpin(guard);
+        return true;
+    }
+
+    bool remove(const E &element)
+    {
+        guard_t guard = pin();
+        node_t *preds[MAXLEVEL];
+        node_t *succs[MAXLEVEL];
+        bool removed = find(element, preds, succs) && remove_node(succs[0]);
+        unpin(guard);
+        return removed;
+    }
+
+    bool has(const E &element) const
+    {
+        guard_t guard = pin();
+        node_t *node = lower_node(element);
+        bool found = node != nullptr && !(element < node->element);
+        unpin(guard);
+        return found;
+    }
+
+    /// \return A copy of the element equal to element
+    optional<E> find(const E &element) const
+    {
+        guard_t guard = pin();
+        node_t *node = lower_node(element);
+        optional<E> result = nullopt;
+        if (node != nullptr && !(element < node->element))
+        {
+            result = node->element;
+        }
+        unpin(guard);
+        return result;
+    }
+
+    /// \return A copy of the first element not less than element
+    optional<E> lower_find(const E &element) const
+    {
+        guard_t guard = pin();
+        node_t *node = lower_node(element);
+        optional<E> result = nullopt;
+        if (node != nullptr)
+        {
+            result = node->element;
+        }
+        unpin(guard);
+        return result;
+    }
+
+    optional<E> front() const
+    {
+        guard_t guard = pin();
+        node_t *node = first_node();
+        optional<E> result = nullopt;
+        if (node != nullptr)
+        {
+            result = node->element;
+        }
+        unpin(guard);
+        return result;
+    }
+
+    /// Remove the smallest element
+    ///
+    /// \return The element removed, or nullopt if the list is empty
+    optional<E> pop_front()
+    {
+        guard_t guard = pin();
+        optional<E> result = nullopt;
+        for (node_t *node = first_node(); node != nullptr; node = first_node())
+        {
+            E element = node->element;
+            if (remove_node(node))
+            {
+                result = std::move(element);
+                break;
+            }
+        }
+        unpin(guard);
+        return result;
+    }
+
+    /// Count of elements, exact only while no operation runs
+    size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+    bool empty() const { return size() == 0; }
+
+  private:
+    Allocator *allocator_;
+    node_t *head_;
+    std::atomic<size_t> size_;
+    std::atomic<uint64_t> epoch_;
+    std::atomic<uint64_t> seed_;
+    // 0 if free, else (epoch << 1) | 1 of a pinned operation
+    mutable slot_t slots_[SLOTS];
+    // (low 32 bits of epoch << 32) | count of operations pinned at that epoch
+    alignas(64) mutable std::atomic<uint64_t> overflow_;
+    std::atomic<node_t *> limbo_[3];
+
+    // count of levels in [1, MAXLEVEL]
+    int random_level()
+    {
+        uint64_t r = detail::fmix64(seed_.fetch_add(0x9E3779B97F4A7C15, std::memory_order_relaxed));
+        return geometric_level<MAXLEVEL>(r) + 1;
+    }
+
+    node_t *make_node(int level)
+    {
+        void *p = allocator_->allocate(sizeof(node_t) + level * sizeof(std::atomic<uintptr_t>), alignof(node_t));
+        return new (p) node_t(level);
+    }
+
+    template <typename... Args> node_t *make_node(int level, Args &&...args)
+    {
+        node_t *node = make_node(level);
+        new (&node->element) E(std::forward<Args>(args)...);
+        return node;
+    }
+
+    void destroy(node_t *node)
+    {
+        node->element.~E();
+        node->~node_t();
+        allocator_->deallocate(node);
+    }
+
+    void free_list(node_t *node)
+    {
+        while (node != nullptr)
+        {
+            node_t *next = node->retired;
+            destroy(node);
+            node = next;
+        }
+    }
+
+    guard_t pin() const
+    {
+        int local;
+        size_t slot = detail::fmix64((uintptr_t)&local >> 6) % SLOTS;
+        for (size_t i = 0; i < SLOTS; i++)
+        {
+            uint64_t epoch = epoch_.load(std::memory_order_acquire);
+            uint64_t expected = 0;
+            if (slots_[slot].value.compare_exchange_strong(expected, (epoch << 1) | 1, std::memory_order_seq_cst))
+            {
+                // the epoch may have moved before the slot was visible
+                uint64_t now = epoch_.load(std::memory_order_seq_cst);
+                while (now != epoch)
+                {
+                    epoch = now;
+                    slots_[slot].value.store((epoch << 1) | 1, std::memory_order_seq_cst);
+                    now = epoch_.load(std::memory_order_seq_cst);
+                }
+                return {slot, epoch};
+            }
+            slot = slot + 1 == SLOTS ? 0 : slot + 1;
+        }
+        return pin_overflow();
+    }
+
+    /// Join the operations pinned at the overflow epoch, the first one stamps the current epoch.
+    /// A later one keeps the older stamp, which only delays reclamation.
+    guard_t pin_overflow() const
+    {
+        uint64_t old = overflow_.load(std::memory_order_seq_cst);
+        for (;;)
+        {
+            uint64_t pinned = (uint32_t)old == 0 ? (epoch_.load(std::memory_order_seq_cst) << 32) | 1 : old + 1;
+            if (overflow_.compare_exchange_weak(old, pinned, std::memory_order_seq_cst))
+            {
+                return {SLOTS, pinned >> 32};
+            }
+        }
+    }
+
+    void unpin(const guard_t &guard) const
+    {
+        if (guard.slot == SLOTS)
+        {
+            overflow_.fetch_sub(1, std::memory_order_release);
+        }
+        else
+        {
+            slots_[guard.slot].value.store(0, std::memory_order_release);
+        }
+    }
+
+    // the node is unlinked, operations pinned before the current epoch may still read it
+    void retire(node_t *node)
+    {
+        std::atomic<node_t *> &limbo = limbo_[epoch_.load(std::memory_order_seq_cst) % 3];
+        node_t *head = limbo.load(std::memory_order_relaxed);
+        do
+        {
+            node->retired = head;
+        } while (!limbo.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+        try_advance();
+    }
+
+    // move the epoch when every pinned operation has seen it, then free
+    // the nodes retired two epochs ago
+    void try_advance()
+    {
+        uint64_t epoch = epoch_.load(std::memory_order_seq_cst);
+        for (size_t i = 0; i < SLOTS; i++)
+        {
+            uint64_t slot = slots_[i].value.load(std::memory_order_seq_cst);
+            if (slot != 0 && (slot >> 1) != epoch)
+            {
+                return;
+            }
+        }
+        uint64_t overflow = overflow_.load(std::memory_order_seq_cst);
+        if ((uint32_t)overflow != 0 && (overflow >> 32) != (uint32_t)epoch)
+        {
+            return;
+        }
+        if (epoch_.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst))
+        {
+            free_list(limbo_[(epoch + 2) % 3].exchange(nullptr, std::memory_order_acquire));
+        }
+    }
+
+    void release(node_t *node)
+    {
+        if (node->owners.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            retire(node);
+        }
+    }
+
+    /// Find the neighbours of element on every level, unlinking marked nodes on the way
+    ///
+    /// \param target walk past equal elements until this node, so a marked target is unlinked
+    /// from every level even when an equal element was inserted before it
+    /// \return true if succs[0] is equal to element
+    bool find(const E &element, node_t **preds, node_t **succs, node_t *target = nullptr)
+    {
+    retry:
+        node_t *pred = head_;
+        for (int l = MAXLEVEL - 1; l >= 0; l--)
+        {
+            node_t *curr = ptr(pred->next[l].load(std::memory_order_acquire));
+            while (curr != nullptr)
+            {
+                uintptr_t succ = curr->next[l].load(std::memory_order_acquire);
+                if (marked(succ))
+                {
+                    uintptr_t expected = (uintptr_t)curr;
+                    if (!pred->next[l].compare_exchange_strong(expected, (uintptr_t)ptr(succ),
+                                                               std::memory_order_acq_rel, std::memory_order_relaxed))
+                    {
+                        goto retry;
+                    }
+                    curr = ptr(succ);
+                    continue;
+                }
+                if (!(curr->element < element) && (target == nullptr || element < curr->element))
+                {
+                    break;
+                }
+                pred = curr;
+                curr = ptr(succ);
+            }
+            preds[l] = pred;
+            succs[l] = curr;
+        }
+        return succs[0] != nullptr && !(element < succs[0]->element);
+    }
+
+    // read only search, marked nodes are skipped, not unlinked
+    node_t *lower_node(const E &element) const
+    {
+        node_t *pred = head_;
+        node_t *curr = nullptr;
+        for (int l = MAXLEVEL - 1; l >= 0; l--)
+        {
+            curr = ptr(pred->next[l].load(std::memory_order_acquire));
+            while (curr != nullptr)
+            {
+                uintptr_t succ = curr->next[l].load(std::memory_order_acquire);
+                if (marked(succ))
+                {
+                    curr = ptr(succ);
+                    continue;
+                }
+                if (!(curr->element < element))
+                {
+                    break;
+                }
+                pred = curr;
+                curr = ptr(succ);
+            }
+        }
+        return curr;
+    }
+
+    node_t *first_node() const
+    {
+        node_t *curr = ptr(head_->next[0].load(std::memory_order_acquire));
+        while (curr != nullptr)
+        {
+            uintptr_t succ = curr->next[0].load(std::memory_order_acquire);
+            if (!marked(succ))
+            {
+                return curr;
+            }
+            curr = ptr(succ);
+        }
+        return nullptr;
+    }
+
+    // link the levels above 0, stop once the node is being removed
+    void link_tower(node_t *node, node_t **preds, node_t **succs)
+    {
+        for (int l = 1; l < node->level; l++)
+        {
+            for (;;)
+            {
+                uintptr_t next = node->next[l].load(std::memory_order_acquire);
+                if (marked(next))
+                {
+                    goto removed;
+                }
+                if (ptr(next) != succs[l] &&
+                    !node->next[l].compare_exchange_strong(next, (uintptr_t)succs[l], std::memory_order_acq_rel))
+                {
+                    continue;
+                }
+                uintptr_t expected = (uintptr_t)succs[l];
+                if (preds[l]->next[l].compare_exchange_strong(expected, (uintptr_t)node, std::memory_order_release,
+                                                              std::memory_order_relaxed))
+                {
+                    break;
+                }
+                find(node->element, preds, succs, node);
+            }
+        }
+    removed:
+        // a remover may have searched before the last level was linked
+        if (marked(node->next[0].load(std::memory_order_acquire)))
+        {
+            find(node->element, preds, succs, node);
+        }
+    }
+
+    /// Mark node from the top level down, the thread marking level 0 owns the removal
+    bool remove_node(node_t *node)
+    {
+        for (int l = node->level - 1; l > 0; l--)
+        {
+            node->next[l].fetch_or(1, std::memory_order_acq_rel);
+        }
+        uintptr_t next = node->next[0].load(std::memory_order_acquire);
+        for (;;)
+        {
+            if (marked(next))
+            {
+                return false;
+            }
+            if (node->next[0].compare_exchange_weak(next, next | 1, std::memory_order_acq_rel))
+            {
+                break;
+            }
+        }
+        size_.fetch_sub(1, std::memory_order_relaxed);
+        node_t *preds[MAXLEVEL];
+        node_t *succs[MAXLEVEL];
+        find(node->element, preds, succs, node);
+        release(node);
+        return true;
+    }
+};
+
+} // namespace freelibcxx
@@ -0,0 +1,439 @@
+#pragma once
+#include "freelibcxx/algorithm.hpp"
+#include "freelibcxx/allocator.hpp"
+#include "freelibcxx/assert.hpp"
+#include "freelibcxx/hash.hpp"
+#include "freelibcxx/utils.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <type_traits>
+
+namespace freelibcxx
+{
+
+/// A bucketized cuckoo hash set with bounded lookups.
+/// Every key has two candidate buckets of 4 slots, a bucket fills one cache line,
+/// so a lookup reads exactly two cache lines (plus a small stash, only while it
+/// is not empty). Inserts make room by a breadth first search of displacements.
+///
+/// Lookups are lock-free and run concurrently with one writer: each bucket has
+/// a sequence counter, and a key is moved with both of its buckets marked, so a
+/// reader never misses a key which is moving. Writers must be serialized by
+/// the caller. Old tables are kept until the set is destroyed.
+template <typename K, typename hash_func = hasher<K>> class cuckoo_hash_set
+{
+    static constexpr size_t slots = 4;
+    static constexpr size_t stash_slots = 8;
+    static constexpr size_t max_search = 256;
+    static constexpr size_t cache_line = 64;
+
+    static_assert(std::is_trivially_copyable_v<K>);
+    static_assert(sizeof(K) * slots + 8 <= cache_line, "a bucket must fit in one cache line");
+
+    struct alignas(cache_line) bucket_t
+    {
+        std::atomic<uint32_t> seq;
+        // bit i set if keys[i] is in use
+        std::atomic<uint32_t> used;
+        K keys[slots];
+    };
+    static_assert(sizeof(bucket_t) == cache_line);
+
+    struct stash_t
+    {
+        std::atomic<uint32_t> seq;
+        std::atomic<uint32_t> used;
+        K keys[stash_slots];
+    };
+
+    struct table_t
+    {
+        table_t *retired;
+        // the allocation holding buckets, which are aligned to cache line
+        void *memory;
+        bucket_t *buckets;
+        size_t cap;
+        stash_t stash;
+    };
+
+    // a bucket reached by the search, slot of parent holds the key moving here
+    struct search_t
+    {
+        uint32_t bucket;
+        int16_t parent;
+        uint8_t slot;
+    };
+
+  public:
+    /// \param capacity The element count expected
+    explicit cuckoo_hash_set(Allocator *allocator, size_t capacity = 0)
+        : allocator_(allocator)
+        , size_(0)
+    {
+        table_.store(make_table(table_capacity(capacity), nullptr), std::memory_order_release);
+    }
+
+    cuckoo_hash_set(const cuckoo_hash_set &) = delete;
+    cuckoo_hash_set &operator=(const cuckoo_hash_set &) = delete;
+
+    ~cuckoo_hash_set() { free(); }
+
+    /// Insert key if absent. The table grows when no room is found.
+    ///
+    /// \return true if inserted
+    bool insert(const K &key)
+    {
+        if (has(key))
+        {
+            return false;
+        }
+        size_t hash = hash_func()(key);
+        table_t *table = table_.load(std::memory_order_relaxed);
+        while (!place(table, key, hash))
+        {
+            table = grow(table);
+        }
+        size_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool remove(const K &key)
+    {
+        size_t hash = hash_func()(key);
+        table_t *table = table_.load(std::memory_order_relaxed);
+        for (bucket_t *bucket : {first_bucket(table, hash), second_bucket(table, hash)})
+        {
+            int slot = find_slot(bucket->used.load(std::memory_order_relaxed), bucket->keys, key, slots);
+            if (slot >= 0)
+            {
+                write_begin(bucket->seq);
+                bucket->used.fetch_and(~(1U << slot), std::memory_order_relaxed);
+                write_end(bucket->seq);
+                size_.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        stash_t &stash = table->stash;
+        int slot = find_slot(stash.used.load(std::memory_order_relaxed), stash.keys, key, stash_slots);
+        if (slot >= 0)
+        {
+            write_begin(stash.seq);
+            stash.used.fetch_and(~(1U << slot), std::memory_order_relaxed);
+            write_end(stash.seq);
+            size_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    /// Lock-free lookup
+    bool has(const K &key) const
+    {
+        size_t hash = hash_func()(key);
+        for (;;)
+        {
+            table_t *table = table_.load(std::memory_order_acquire);
+            const bucket_t *a = first_bucket(table, hash);
+            const bucket_t *b = second_bucket(table, hash);
+            uint32_t seq_a = read_begin(a->seq);
+            uint32_t seq_b = read_begin(b->seq);
+            bool found = find_slot(a->used.load(std::memory_order_relaxed), a->keys, key, slots) >= 0 ||
+                         find_slot(b->used.load(std::memory_order_relaxed), b->keys, key, slots) >= 0;
+            if (!read_valid(a->seq, seq_a) || !read_valid(b->seq, seq_b)) [[unlikely]]
+            {
+                continue;
+            }
+            if (found)
+            {
+                return true;
+            }
+            const stash_t &stash = table->stash;
+            uint32_t seq = read_begin(stash.seq);
+            uint32_t used = stash.used.load(std::memory_order_relaxed);
+            if (used == 0) [[likely]]
+            {
+                return false;
+            }
+            found = find_slot(used, stash.keys, key, stash_slots) >= 0;
+            if (read_valid(stash.seq, seq))
+            {
+                return found;
+            }
+        }
+    }
+
+    size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+    /// \return Count of slots in buckets
+    size_t capacity() const { return table_.load(std::memory_order_acquire)->cap * slots; }
+
+  private:
+    Allocator *allocator_;
+    std::atomic<table_t *> table_;
+    std::atomic<size_t> size_;
+
+    static size_t table_capacity(size_t element_count)
+    {
+        // about 90% load is reachable with 4 slots per bucket
+        return max((size_t)2, next_pow_of_2((element_count * 10 / 9 + slots - 1) / slots));
+    }
+
+    static bucket_t *first_bucket(table_t *table, size_t hash) { return &table->buckets[hash & (table->cap - 1)]; }
+
+    static bucket_t *second_bucket(table_t *table, size_t hash)
+    {
+        return &table->buckets[detail::fmix64(hash ^ 0x9E3779B97F4A7C15) & (table->cap - 1)];
+    }
+
+    static int find_slot(uint32_t used, const K *keys, const K &key, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            if ((used & (1U << i)) && keys[i] == key)
+            {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    static int free_slot(const bucket_t *bucket)
+    {
+        uint32_t free = ~bucket->used.load(std::memory_order_relaxed) & ((1U << slots) - 1);
+        return free != 0 ? __builtin_ctz(free) : -1;
+    }
+
+    table_t *make_table(size_t cap, table_t *retired)
+    {
+        table_t *table = allocator_->New<table_t>();
+        table->retired = retired;
+        table->memory = allocator_->allocate(cap * sizeof(bucket_t) + cache_line, cache_line);
+        table->buckets = (bucket_t *)(((uintptr_t)table->memory + cache_line - 1) & ~(uintptr_t)(cache_line - 1));
+        table->cap = cap;
+        for (size_t i = 0; i < cap; i++)
+        {
+            bucket_t *bucket = new (&table->buckets[i]) bucket_t();
+            bucket->seq.store(0, std::memory_order_relaxed);
+            bucket->used.store(0, std::memory_order_relaxed);
+        }
+        table->stash.seq.store(0, std::memory_order_relaxed);
+        table->stash.used.store(0, std::memory_order_relaxed);
+        return table;
+    }
+
+    static void write_begin(std::atomic<uint32_t> &seq)
+    {
+        seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    static void write_end(std::atomic<uint32_t> &seq)
+    {
+        seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    static uint32_t read_begin(const std::atomic<uint32_t> &seq)
+    {
+        for (;;)
+        {
+            uint32_t s = seq.load(std::memory_order_acquire);
+            if ((s & 1) == 0) [[likely]]
+                return s;
+            detail::cpu_relax();
+        }
+    }
+
+    static bool read_valid(const std::atomic<uint32_t> &seq, uint32_t s)
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return seq.load(std::memory_order_relaxed) == s;
+    }
+
+    static void fill(bucket_t *bucket, int slot, const K &key)
+    {
+        write_begin(bucket->seq);
+        bucket->keys[slot] = key;
+        bucket->used.fetch_or(1U << slot, std::memory_order_relaxed);
+        write_end(bucket->seq);
+    }
+
+    // move a key between its two buckets, both are marked while it moves
+    static void move_key(bucket_t *from, int from_slot, bucket_t *to, int to_slot)
+    {
+        write_begin(from->seq);
+        write_begin(to->seq);
+        to->keys[to_slot] = from->keys[from_slot];
+        to->used.fetch_or(1U << to_slot, std::memory_order_relaxed);
+        from->used.fetch_and(~(1U << from_slot), std::memory_order_relaxed);
+        write_end(to->seq);
+        write_end(from->seq);
+    }
+
+    /// Put key into table, displacing keys or using the stash
+    ///
+    /// \return false if the table is full
+    bool place(table_t *table, const K &key, size_t hash)
+    {
+        bucket_t *roots[2] = {first_bucket(table, hash), second_bucket(table, hash)};
+        for (bucket_t *bucket : roots)
+        {
+            if (int slot = free_slot(bucket); slot >= 0)
+            {
+                fill(bucket, slot, key);
+                return true;
+            }
+        }
+        if (displace(table, roots))
+        {
+            for (bucket_t *bucket : roots)
+            {
+                if (int slot = free_slot(bucket); slot >= 0)
+                {
+                    fill(bucket, slot, key);
+                    return true;
+                }
+            }
+        }
+        stash_t &stash = table->stash;
+        uint32_t free = ~stash.used.load(std::memory_order_relaxed) & ((1U << stash_slots) - 1);
+        if (free == 0)
+        {
+            return false;
+        }
+        int slot = __builtin_ctz(free);
+        write_begin(stash.seq);
+        stash.keys[slot] = key;
+        stash.used.fetch_or(1U << slot, std::memory_order_relaxed);
+        write_end(stash.seq);
+        return true;
+    }
+
+    /// Search the shortest chain of displacements ending in a free slot,
+    /// then move keys backwards along it so a root bucket has a free slot.
+    bool displace(table_t *table, bucket_t *const (&roots)[2])
+    {
+        search_t queue[max_search];
+        size_t tail = 0;
+        for (bucket_t *root : roots)
+        {
+            queue[tail++] = {(uint32_t)(root - table->buckets), -1, 0};
+        }
+        size_t found = max_search;
+        for (size_t head = 0; head < tail && found == max_search; head++)
+        {
+            bucket_t *bucket = &table->buckets[queue[head].bucket];
+            for (size_t slot = 0; slot < slots && tail < max_search; slot++)
+            {
+                size_t hash = hash_func()(bucket->keys[slot]);
+                bucket_t *alt = first_bucket(table, hash);
+                if (alt == bucket)
+                {
+                    alt = second_bucket(table, hash);
+                }
+                if (alt == bucket || on_path(queue, head, alt - table->buckets))
+                {
+                    continue;
+                }
+                queue[tail++] = {(uint32_t)(alt - table->buckets), (int16_t)head, (uint8_t)slot};
+                if (free_slot(alt) >= 0)
+                {
+                    found = tail - 1;
+                    break;
+                }
+            }
+        }
+        if (found == max_search)
+        {
+            return false;
+        }
+        for (size_t i = found; queue[i].parent >= 0; i = queue[i].parent)
+        {
+            bucket_t *to = &table->buckets[queue[i].bucket];
+            bucket_t *from = &table->buckets[queue[queue[i].parent].bucket];
+            move_key(from, queue[i].slot, to, free_slot(to));
+        }
+        return true;
+    }
+
+    // a chain must not pass a bucket twice
+    static bool on_path(const search_t *queue, size_t index, size_t bucket)
+    {
+        for (int i = index; i >= 0; i = queue[i].parent)
+        {
+            if (queue[i].bucket == bucket)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // rebuild into tables twice as large until every key fits, then publish
+    table_t *grow(table_t *old)
+    {
+        size_t cap = old->cap * 2;
+        for (;;)
+        {
+            table_t *table = make_table(cap, old);
+            if (rehash(old, table))
+            {
+                table_.store(table, std::memory_order_release);
+                return table;
+            }
+            table->retired = nullptr;
+            delete_table(table);
+            cap *= 2;
+        }
+    }
+
+    bool rehash(table_t *old, table_t *table)
+    {
+        for (size_t i = 0; i < old->cap; i++)
+        {
+            bucket_t &bucket = old->buckets[i];
+            uint32_t used = bucket.used.load(std::memory_order_relaxed);
+            for (size_t j = 0; j < slots; j++)
+            {
+                if ((used & (1U << j)) && !place(table, bucket.keys[j], hash_func()(bucket.keys[j])))
+                {
+                    return false;
+                }
+            }
+        }
+        uint32_t used = old->stash.used.load(std::memory_order_relaxed);
+        for (size_t j = 0; j < stash_slots; j++)
+        {
+            if ((used & (1U << j)) && !place(table, old->stash.keys[j], hash_func()(old->stash.keys[j])))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void delete_table(table_t *table)
+    {
+        for (size_t i = 0; i < table->cap; i++)
+        {
+            table->buckets[i].~bucket_t();
+        }
+        allocator_->deallocate(table->memory);
+        allocator_->Delete(table);
+    }
+
+    void free() noexcept
+    {
+        table_t *table = table_.load(std::memory_order_relaxed);
+        while (table != nullptr)
+        {
+            table_t *retired = table->retired;
+            delete_table(table);
+            table = retired;
+        }
+        table_.store(nullptr, std::memory_order_relaxed);
+    }
+};
+
+} // namespace freelibcxx
@@ -0,0 +1,635 @@
+#pragma once
+#include "freelibcxx/algorithm.hpp"
+#include "freelibcxx/allocator.hpp"
+#include "freelibcxx/assert.hpp"
+#include "freelibcxx/bit_set.hpp"
+#include "freelibcxx/extern.hpp"
+#include "freelibcxx/hash.hpp"
+#include "freelibcxx/optional.hpp"
+#include "freelibcxx/span.hpp"
+#include "freelibcxx/utils.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace freelibcxx
+{
+namespace detail
+{
+struct filter_hash_t
+{
+    uint64_t h1;
+    uint64_t h2;
+};
+
+inline filter_hash_t filter_hash(const void *data, size_t len)
+{
+    uint64_t out[2];
+    murmur_hash3_128(data, len, 0, out);
+    return {out[0], out[1]};
+}
+
+// serialized filters start with it, the byte order is the host one
+struct filter_header
+{
+    uint32_t magic;
+    uint32_t param;
+    uint64_t slots;
+    uint64_t count;
+};
+
+// map hash to [0, n) by multiply and shift, n need not be a power of 2
+inline size_t fast_range(uint64_t hash, size_t n) { return (size_t)(((unsigned __int128)hash * n) >> 64); }
+
+// keys are hashed in batches, the memory of a batch is prefetched before any probe
+constexpr size_t filter_batch = 16;
+} // namespace detail
+
+/// A bloom filter over a bit_set, the k probes come from double hashing
+/// the two halves of murmur_hash3_128. The bit count is exactly expected_count *
+/// bits_per_key rounded up to a whole block, probes are mapped onto it with
+/// multiply and shift.
+///
+/// The false positive rate is tuned by bits per key, a standard layout gives
+/// about 10% at 5, 1% at 10, 0.1% at 15. The blocked layout keeps all probes of
+/// a key in one 64 byte cache line, a probe is one cache miss, for a slightly
+/// higher rate at the same size.
+class bloom_filter
+{
+    static constexpr uint32_t magic = 0x464d4c42; // "BLMF"
+    static constexpr size_t block_bits = 512;
+    static constexpr size_t block_words = block_bits / 64;
+
+  public:
+    /// \param expected_count The count of keys expected
+    /// \param bits_per_key Bits of filter memory for each key
+    /// \param blocked Use the cache line blocked layout
+    bloom_filter(Allocator *allocator, size_t expected_count, size_t bits_per_key = 10, bool blocked = false)
+        : bits_(allocator, bit_count(expected_count, bits_per_key))
+        , probes_(clamp<size_t>(bits_per_key * 69 / 100, 1, 30))
+        , blocked_(blocked)
+        , count_(0)
+    {
+        bits_.reset_all();
+    }
+
+    /// Load a filter written by serialize
+    ///
+    /// \return nullopt if bytes do not hold a bloom filter
+    static optional<bloom_filter> from_bytes(Allocator *allocator, span<const std::byte> bytes)
+    {
+        detail::filter_header header;
+        if (bytes.size() < sizeof(header))
+        {
+            return nullopt;
+        }
+        memcpy(&header, bytes.get(), sizeof(header));
+        size_t probes = header.param & 0xffff;
+        if (header.magic != magic || header.slots < block_bits || header.slots % block_bits != 0 || probes == 0 ||
+            bytes.size() != sizeof(header) + header.slots / 8)
+        {
+            return nullopt;
+        }
+        // one bit per key sizes the bit_set to header.slots
+        bloom_filter filter(allocator, header.slots, 1);
+        filter.probes_ = probes;
+        filter.blocked_ = header.param >> 16;
+        memcpy(filter.bits_.get_ptr(), bytes.get() + sizeof(header), header.slots / 8);
+        filter.count_ = header.count;
+        return filter;
+    }
+
+    void add(const void *data, size_t len) { add_hash(detail::filter_hash(data, len)); }
+
+    void add(span<const std::byte> bytes) { add(bytes.get(), bytes.size()); }
+
+    template <typename T>
+    requires std::is_trivially_copyable_v<T>
+    void add(const T &key)
+    {
+        add(&key, sizeof(T));
+    }
+
+    template <typename T>
+    requires std::is_trivially_copyable_v<T>
+    void add_many(span<const T> keys)
+    {
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            add(keys.get()[i]);
+        }
+    }
+
+    /// \return false if the key was never added, true if it probably was
+    bool may_contain(const void *data, size_t len) const { return test_hash(detail::filter_hash(data, len)); }
+
+    bool may_contain(span<const std::byte> bytes) const { return may_contain(bytes.get(), bytes.size()); }
+
+    template <typename T>
+    requires std::is_trivially_copyable_v<T>
+    bool may_contain(const T &key) const
+    {
+        return may_contain(&key, sizeof(T));
+    }
+
+    /// Test keys in batches, the cache lines of a batch are fetched together
+    ///
+    /// \param result result[i] is may_contain(keys[i])
+    /// \return The count of keys which may be contained
+    template <typename T>
+    requires std::is_trivially_copyable_v<T>
+    size_t may_contain_many(span<const T> keys, span<bool> result) const
+    {
+        CXXASSERT(result.size() >= keys.size());
+        const T *data = keys.get();
+        bool *out = result.get();
+        size_t found = 0;
+        detail::filter_hash_t hashes[detail::filter_batch];
+        for (size_t beg = 0; beg < keys.size(); beg += detail::filter_batch)
+        {
+            size_t n = min(detail::filter_batch, keys.size() - beg);
+            for (size_t i = 0; i < n; i++)
+            {
+                hashes[i] = detail::filter_hash(&data[beg + i], sizeof(T));
+                __builtin_prefetch(bits_.get_ptr() + first_word(hashes[i]));
+            }
+            for (size_t i = 0; i < n; i++)
+            {
+                out[beg + i] = test_hash(hashes[i]);
+                found += out[beg + i];
+            }
+        }
+        return found;
+    }
+
+    void clear()
+    {
+        bits_.reset_all();
+        count_ = 0;
+    }
+
+    /// \return The count of add calls
+    size_t size() const { return count_; }
+
+    size_t bit_size() const { return bits_.count(); }
+
+    size_t probes() const { return probes_; }
+
+    size_t serialized_size() const { return sizeof(detail::filter_header) + bits_.count() / 8; }
+
+    /// \return Bytes written, or 0 if bytes is too small
+    size_t serialize(span<std::byte> bytes) const
+    {
+        size_t size = serialized_size();
+        if (bytes.size() < size)
+        {
+            return 0;
+        }
+        detail::filter_header header = {magic, (uint32_t)(probes_ | (blocked_ << 16)), bits_.count(), count_};
+        memcpy(bytes.get(), &header, sizeof(header));
+        memcpy(bytes.get() + sizeof(header), bits_.get_ptr(), bits_.count() / 8);
+        return size;
+    }
+
+  private:
+    bit_set bits_;
+    size_t probes_;
+    bool blocked_;
+    size_t count_;
+
+    static size_t bit_count(size_t expected_count, size_t bits_per_key)
+    {
+        size_t bits = expected_count * bits_per_key;
+        return max(block_bits, (bits + block_bits - 1) / block_bits * block_bits);
+    }
+
+    size_t first_word(const detail::filter_hash_t &hash) const
+    {
+        if (blocked_)
+        {
+            return block_of(hash) * block_words;
+        }
+        return detail::fast_range(hash.h1, bits_.count()) / 64;
+    }
+
+    size_t block_of(const detail::filter_hash_t &hash) const
+    {
+        return detail::fast_range(hash.h2, bits_.count() / block_bits);
+    }
+
+    // bits of a key in its block, as 8 words
+    void block_mask(const detail::filter_hash_t &hash, uint64_t (&mask)[block_words]) const
+    {
+        uint64_t delta = (hash.h1 >> 32) | 1;
+        for (size_t i = 0; i < block_words; i++)
+        {
+            mask[i] = 0;
+        }
+        for (size_t i = 0; i < probes_; i++)
+        {
+            size_t bit = (hash.h1 + i * delta) & (block_bits - 1);
+            mask[bit / 64] |= 1UL << (bit % 64);
+        }
+    }
+
+    void add_hash(const detail::filter_hash_t &hash)
+    {
+        count_++;
+        if (blocked_)
+        {
+            uint64_t mask[block_words];
+            block_mask(hash, mask);
+            size_t *block = bits_.get_ptr() + block_of(hash) * block_words;
+            for (size_t i = 0; i < block_words; i++)
+            {
+                block[i] |= mask[i];
+            }
+            return;
+        }
+        size_t n = bits_.count();
+        for (size_t i = 0; i < probes_; i++)
+        {
+            bits_.set_bit(detail::fast_range(hash.h1 + i * (hash.h2 | 1), n));
+        }
+    }
+
+    bool test_hash(const detail::filter_hash_t &hash) const
+    {
+        if (blocked_)
+        {
+            uint64_t mask[block_words];
+            block_mask(hash, mask);
+            const size_t *block = bits_.get_ptr() + block_of(hash) * block_words;
+            // branch free over the whole line, the compiler vectorizes it
+            uint64_t miss = 0;
+            for (size_t i = 0; i < block_words; i++)
+            {
+                miss |= mask[i] & ~block[i];
+            }
+            return miss == 0;
+        }
+        size_t n = bits_.count();
+        for (size_t i = 0; i < probes_; i++)
+        {
+            if (!bits_.get_bit(detail::fast_range(hash.h1 + i * (hash.h2 | 1), n)))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+/// A cuckoo filter, which supports remove unlike bloom_filter.
+/// Each key keeps a fingerprint of F in one of two buckets of 4 slots.
+/// The false positive rate is about 8 / 2^bits of F: 3% for uint8_t,
+/// 0.012% for uint16_t. A filter fills up at about 95% of its slots,
+/// add fails after that.
+template <typename F = uint16_t> class cuckoo_filter
+{
+    static_assert(std::is_unsigned_v<F> && sizeof(F) <= 4);
+    static constexpr uint32_t magic = 0x464b4355; // "UCKF"
+    static constexpr size_t slots = 4;
+    static constexpr size_t max_kicks = 500;
+
+  public:
+    /// \param expected_count The count of keys expected
+    cuckoo_filter(Allocator *allocator, size_t expected_count)
+        : cuckoo_filter(allocator, bucket_tag{}, bucket_count(expected_count))
+    {
+    }
+
+    cuckoo_filter(const cuckoo_filter &) = delete;
+    cuckoo_filter &operator=(const cuckoo_filter &) = delete;
+
+    cuckoo_filter(cuckoo_filter &&rhs) noexcept
+        : allocator_(rhs.allocator_)
+        , buckets_(rhs.buckets_)
+        , table_(rhs.table_)
+        , count_(rhs.count_)
+        , victim_bucket_(rhs.victim_bucket_)
+        , victim_(rhs.victim_)
+        , random_(rhs.random_)
+    {
+        rhs.table_ = nullptr;
+    }
+
+    ~cuckoo_filter()
+    {
+        if (table_ != nullptr)
+        {
+            allocator_->DeleteArray(buckets_ * slots, table_);
+        }
+    }
+
+    /// Load a filter written by serialize
+    ///
+    /// \return nullopt if bytes do not hold a cuckoo filter of F
+    static optional<cuckoo_filter> from_bytes(Allocator *allocator, span<const std::byte> bytes)
+    {
+        detail::filter_header header;
+        if (bytes.size() < sizeof(header))
+        {
+            return nullopt;
+        }
+        memcpy(&header, bytes.get(), sizeof(header));
+        size_t table_bytes = header.slots * sizeof(F);
+        if (header.magic != magic || (header.param & 0xff) != sizeof(F) || header.slots < slots * 2 ||
+            !is_pow_of_2(header.slots) || bytes.size() != sizeof(header) + table_bytes + sizeof(F) + 8)
+        {
+            return nullopt;
+        }
+        cuckoo_filter filter(allocator, bucket_tag{}, header.slots / slots);
+        const std::byte *p = bytes.get() + sizeof(header);
+        memcpy(filter.table_, p, table_bytes);
+        memcpy(&filter.victim_, p + table_bytes, sizeof(F));
+        memcpy(&filter.victim_bucket_, p + table_bytes + sizeof(F), 8);
+        filter.count_ = header.count;
+        return filter;
+    }
+
+    /// \return false if the filter is full
+    bool add(const void *data, size_t len) { return add_hash(detail::filter_hash(data, len)); }
+
+    bool add(span<const std::byte> bytes) { return add(bytes.get(), bytes.size()); }
+
+    template <typename T>
+    requires std::is_trivially_copyable_v<T>
+    bool add(const T &key)
+    {
+        return add(&key, sizeof(T));
+    }
+
+    /// \return The count of keys added before the filter is full
+    template <typename T>
+    requires std::is_trivially_copyable_v<T>
+    size_t add_many(span<const T> keys)
+    {
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            if (!add(keys.get()[i]))
+            {
+                return i;
+            }
+        }
+        return keys.size();
+    }
+
+    bool may_contain(const void *data, size_t len) const { return test_hash(detail::filter_hash(data, len)); }
+
+    bool may_contain(span<const std::byte> bytes) const { return may_contain(bytes.get(), bytes.size()); }
+
+    template <typename T>
+    requires std::is_trivially_copyable_v<T>
+    bool may_contain(const T &key) const
+    {
+        return may_contain(&key, sizeof(T));
+    }
+
+    /// Test keys in batches, the buckets of a batch are fetched together
+    ///
+    /// \param result result[i] is may_contain(keys[i])
+    /// \return The count of keys which may be contained
+    template <typename T>
+    requires std::is_trivially_copyable_v<T>
+    size_t may_contain_many(span<const T> keys, span<bool> result) const
+    {
+        CXXASSERT(result.size() >= keys.size());
+        const T *data = keys.get();
+        bool *out = result.get();
+        size_t found = 0;
+        detail::filter_hash_t hashes[detail::filter_batch];
+        for (size_t beg = 0; beg < keys.size(); beg += detail::filter_batch)
+        {
+            size_t n = min(detail::filter_batch, keys.size() - beg);
+            for (size_t i = 0; i < n; i++)
+            {
+                hashes[i] = detail::filter_hash(&data[beg + i], sizeof(T));
+                size_t index = first_index(hashes[i]);
+                __builtin_prefetch(table_ + index * slots);
+                __builtin_prefetch(table_ + alt_index(index, fingerprint(hashes[i])) * slots);
+            }
+            for (size_t i = 0; i < n; i++)
+            {
+                out[beg + i] = test_hash(hashes[i]);
+                found += out[beg + i];
+            }
+        }
+        return found;
+    }
+
+    /// Remove a key which was added. Removing a key never added may remove
+    /// another key sharing its fingerprint.
+    bool remove(const void *data, size_t len) { return remove_hash(detail::filter_hash(data, len)); }
+
+    bool remove(span<const std::byte> bytes) { return remove(bytes.get(), bytes.size()); }
+
+    template <typename T>
+    requires std::is_trivially_copyable_v<T>
+    bool remove(const T &key)
+    {
+        return remove(&key, sizeof(T));
+    }
+
+    void clear()
+    {
+        for (size_t i = 0; i < buckets_ * slots; i++)
+        {
+            table_[i] = 0;
+        }
+        victim_ = 0;
+        count_ = 0;
+    }
+
+    size_t size() const { return count_; }
+
+    /// \return The count of fingerprint slots
+    size_t capacity() const { return buckets_ * slots; }
+
+    size_t serialized_size() const { return sizeof(detail::filter_header) + capacity() * sizeof(F) + sizeof(F) + 8; }
+
+    /// \return Bytes written, or 0 if bytes is too small
+    size_t serialize(span<std::byte> bytes) const
+    {
+        size_t size = serialized_size();
+        if (bytes.size() < size)
+        {
+            return 0;
+        }
+        detail::filter_header header = {magic, sizeof(F), capacity(), count_};
+        std::byte *p = bytes.get();
+        memcpy(p, &header, sizeof(header));
+        p += sizeof(header);
+        memcpy(p, table_, capacity() * sizeof(F));
+        p += capacity() * sizeof(F);
+        memcpy(p, &victim_, sizeof(F));
+        memcpy(p + sizeof(F), &victim_bucket_, 8);
+        return size;
+    }
+
+  private:
+    struct bucket_tag
+    {
+    };
+
+    cuckoo_filter(Allocator *allocator, bucket_tag, size_t buckets)
+        : allocator_(allocator)
+        , buckets_(buckets)
+        , table_(allocator_->NewArray<F>(buckets_ * slots, 0))
+        , count_(0)
+        , victim_bucket_(0)
+        , victim_(0)
+        , random_(0x9E3779B97F4A7C15)
+    {
+    }
+
+    static size_t bucket_count(size_t expected_count)
+    {
+        return max((size_t)2, next_pow_of_2((expected_count * 100 / 95 + slots - 1) / slots));
+    }
+
+    Allocator *allocator_;
+    size_t buckets_;
+    F *table_;
+    size_t count_;
+    // a fingerprint evicted by a failed add, the filter is full while it is held
+    uint64_t victim_bucket_;
+    F victim_;
+    uint64_t random_;
+
+    static F fingerprint(const detail::filter_hash_t &hash)
+    {
+        F f = (F)hash.h2;
+        return f != 0 ? f : 1;
+    }
+
+    size_t first_index(const detail::filter_hash_t &hash) const { return hash.h1 & (buckets_ - 1); }
+
+    // the two buckets of a fingerprint are found from each other
+    size_t alt_index(size_t index, F f) const { return (index ^ detail::fmix64(f)) & (buckets_ - 1); }
+
+    bool bucket_has(size_t index, F f) const
+    {
+        const F *bucket = table_ + index * slots;
+        bool found = false;
+        for (size_t i = 0; i < slots; i++)
+        {
+            found |= bucket[i] == f;
+        }
+        return found;
+    }
+
+    bool bucket_put(size_t index, F f)
+    {
+        F *bucket = table_ + index * slots;
+        for (size_t i = 0; i < slots; i++)
+        {
+            if (bucket[i] == 0)
+            {
+                bucket[i] = f;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool bucket_remove(size_t index, F f)
+    {
+        F *bucket = table_ + index * slots;
+        for (size_t i = 0; i < slots; i++)
+        {
+            if (bucket[i] == f)
+            {
+                bucket[i] = 0;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t next_random()
+    {
+        random_ ^= random_ << 13;
+        random_ ^= random_ >> 7;
+        random_ ^= random_ << 17;
+        return random_;
+    }
+
+    bool add_hash(const detail::filter_hash_t &hash)
+    {
+        if (victim_ != 0)
+        {
+            return false;
+        }
+        count_++;
+        F f = fingerprint(hash);
+        size_t index = first_index(hash);
+        if (next_random() & 1)
+        {
+            index = alt_index(index, f);
+        }
+        place(f, index);
+        return true;
+    }
+
+    // put f into one of its buckets, kicking fingerprints to their other buckets
+    void place(F f, size_t index)
+    {
+        if (bucket_put(index, f) || bucket_put(alt_index(index, f), f))
+        {
+            return;
+        }
+        for (size_t kick = 0; kick < max_kicks; kick++)
+        {
+            F &slot = table_[index * slots + next_random() % slots];
+            F evicted = slot;
+            slot = f;
+            f = evicted;
+            index = alt_index(index, f);
+            if (bucket_put(index, f))
+            {
+                return;
+            }
+        }
+        // the last evicted fingerprint is held aside, it is still in the filter
+        victim_ = f;
+        victim_bucket_ = index;
+    }
+
+    bool test_hash(const detail::filter_hash_t &hash) const
+    {
+        F f = fingerprint(hash);
+        size_t index = first_index(hash);
+        size_t alt = alt_index(index, f);
+        bool victim = victim_ == f && (victim_bucket_ == index || victim_bucket_ == alt);
+        return bucket_has(index, f) | bucket_has(alt, f) | victim;
+    }
+
+    bool remove_hash(const detail::filter_hash_t &hash)
+    {
+        F f = fingerprint(hash);
+        size_t index = first_index(hash);
+        size_t alt = alt_index(index, f);
+        if (victim_ == f && (victim_bucket_ == index || victim_bucket_ == alt))
+        {
+            victim_ = 0;
+            count_--;
+            return true;
+        }
+        if (bucket_remove(index, f) || bucket_remove(alt, f))
+        {
+            count_--;
+            // there is room now, put the victim back
+            if (victim_ != 0)
+            {
+                F victim = victim_;
+                victim_ = 0;
+                place(victim, victim_bucket_);
+            }
+            return true;
+        }
+        return false;
+    }
+};
+
+} // namespace freelibcxx
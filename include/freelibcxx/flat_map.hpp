@@ -0,0 +1,236 @@
+#pragma once
+#include "freelibcxx/algorithm.hpp"
+#include "freelibcxx/allocator.hpp"
+#include "freelibcxx/assert.hpp"
+#include "freelibcxx/optional.hpp"
+#include "freelibcxx/span.hpp"
+#include "freelibcxx/vector.hpp"
+#include <type_traits>
+#include <utility>
+
+namespace freelibcxx
+{
+
+template <typename K> struct flat_set_pair
+{
+    using Key = K;
+    K key;
+    template <typename... Args>
+    requires std::is_constructible_v<K, Args...>
+    flat_set_pair(Args &&...args)
+        : key(std::forward<Args>(args)...)
+    {
+    }
+    bool operator<(const K &rhs) const { return key < rhs; }
+};
+
+template <typename K, typename V> struct flat_map_pair : flat_set_pair<K>
+{
+    V value;
+    template <typename... Args>
+    flat_map_pair(K key, Args &&...args)
+        : flat_set_pair<K>(key)
+        , value(std::forward<Args>(args)...)
+    {
+    }
+};
+
+/// A sorted map on contiguous storage.
+/// Lookups are binary searches, inserts and removes move the tail.
+/// Best for small or read-mostly maps.
+template <typename P> class base_flat_map
+{
+  protected:
+    using K = typename P::Key;
+
+  public:
+    using iterator = typename base_vector<P>::iterator;
+    using const_iterator = typename base_vector<P>::const_iterator;
+
+    explicit base_flat_map(Allocator *allocator)
+        : elements_(allocator)
+    {
+    }
+
+    base_flat_map(Allocator *allocator, std::initializer_list<P> il)
+        : elements_(allocator)
+    {
+        elements_.ensure(il.size());
+        for (const P &e : il)
+        {
+            insert(e);
+        }
+    }
+
+    /// Insert a new element only if key is absent
+    ///
+    /// \return The element with key, and whether it was inserted
+    template <typename... Args> std::pair<iterator, bool> insert(Args &&...args)
+    {
+        P p(std::forward<Args>(args)...);
+        auto it = lower_find(p.key);
+        if (it != elements_.end() && !(p.key < it->key))
+        {
+            return std::make_pair(it, false);
+        }
+        return std::make_pair(elements_.insert(it, std::move(p)), true);
+    }
+
+    /// Merge sorted elements with unique keys in one pass.
+    /// Keys already present are skipped.
+    void insert_sorted(span<const P> items)
+    {
+        if (items.size() == 0)
+        {
+            return;
+        }
+        const P *src = items.get();
+        base_vector<P> merged(elements_.allocator());
+        merged.ensure(elements_.size() + items.size());
+        size_t i = 0, j = 0;
+        while (i < elements_.size() && j < items.size())
+        {
+            if (elements_[i].key < src[j].key)
+            {
+                merged.push_back(std::move(elements_[i++]));
+            }
+            else if (src[j].key < elements_[i].key)
+            {
+                merged.push_back(src[j++]);
+            }
+            else
+            {
+                merged.push_back(std::move(elements_[i++]));
+                j++;
+            }
+        }
+        for (; i < elements_.size(); i++)
+        {
+            merged.push_back(std::move(elements_[i]));
+        }
+        for (; j < items.size(); j++)
+        {
+            merged.push_back(src[j]);
+        }
+        elements_ = std::move(merged);
+    }
+
+    /// Take over a vector whose elements are sorted by unique keys
+    void adopt_sorted(base_vector<P> &&elements)
+    {
+        for (size_t i = 1; i < elements.size(); i++)
+        {
+            CXXASSERT_MSG(elements[i - 1].key < elements[i].key, "elements are not sorted");
+        }
+        elements_ = std::move(elements);
+    }
+
+    iterator find(const K &key)
+    {
+        auto it = lower_find(key);
+        if (it != elements_.end() && !(key < it->key))
+        {
+            return it;
+        }
+        return elements_.end();
+    }
+
+    /// \return The first element whose key is not less than key
+    iterator lower_find(const K &key) { return lower_bound(elements_.begin(), elements_.end(), key); }
+
+    bool has(const K &key) { return find(key) != elements_.end(); }
+
+    bool remove(const K &key)
+    {
+        auto it = find(key);
+        if (it == elements_.end())
+        {
+            return false;
+        }
+        elements_.remove(it);
+        return true;
+    }
+
+    iterator remove(iterator iter) { return elements_.remove(iter); }
+
+    void reserve(size_t element_count) { elements_.ensure(element_count); }
+
+    void shrink_to_fit() { elements_.fitcapacity(); }
+
+    void clear() { elements_.clear(); }
+
+    size_t size() const { return elements_.size(); }
+
+    bool empty() const { return elements_.empty(); }
+
+    size_t capacity() const { return elements_.capacity(); }
+
+    P &at(size_t index) { return elements_.at(index); }
+
+    const P &at(size_t index) const { return elements_.at(index); }
+
+    span<P> elements() { return elements_.span(); }
+
+    iterator begin() { return elements_.begin(); }
+
+    iterator end() { return elements_.end(); }
+
+    const_iterator begin() const { return elements_.begin(); }
+
+    const_iterator end() const { return elements_.end(); }
+
+  protected:
+    base_vector<P> elements_;
+};
+
+template <typename K, typename V> class flat_map : public base_flat_map<flat_map_pair<K, V>>
+{
+    using Parent = base_flat_map<flat_map_pair<K, V>>;
+
+  public:
+    using Parent::Parent;
+
+    optional<V> get(const K &key)
+    {
+        V *v = get_ptr(key);
+        if (v == nullptr)
+        {
+            return nullopt;
+        }
+        return *v;
+    }
+
+    V *get_ptr(const K &key)
+    {
+        auto it = this->find(key);
+        if (it == this->elements_.end())
+        {
+            return nullptr;
+        }
+        return &it->value;
+    }
+
+    /// Insert key with value, or assign value to the existing element
+    ///
+    /// \return The element with key, and whether it was inserted
+    template <typename M> std::pair<typename Parent::iterator, bool> insert_or_assign(const K &key, M &&value)
+    {
+        auto it = this->lower_find(key);
+        if (it != this->elements_.end() && !(key < it->key))
+        {
+            it->value = std::forward<M>(value);
+            return std::make_pair(it, false);
+        }
+        return std::make_pair(this->elements_.insert(it, key, std::forward<M>(value)), true);
+    }
+};
+
+template <typename K> class flat_set : public base_flat_map<flat_set_pair<K>>
+{
+    using Parent = base_flat_map<flat_set_pair<K>>;
+
+  public:
+    using Parent::Parent;
+};
+
+} // namespace freelibcxx
@@ -0,0 +1,162 @@
+#pragma once
+#include "freelibcxx/algorithm.hpp"
+#include "freelibcxx/hash.hpp"
+#include "freelibcxx/static_map.hpp"
+#include "freelibcxx/string.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace freelibcxx
+{
+template <typename K> struct frozen_key;
+
+template <typename K>
+requires std::is_integral_v<K> || std::is_enum_v<K>
+struct frozen_key<K>
+{
+    using query_t = K;
+    static constexpr uint64_t hash(const K &key) { return hasher<K>()(key); }
+    static constexpr bool equal(const K &key, const K &query) { return key == query; }
+};
+
+/// string literal keys, looked up by const_string_view
+template <> struct frozen_key<const char *>
+{
+    using query_t = const_string_view;
+    static constexpr uint64_t hash(const char *key) { return detail::wyhash(key, detail::const_strlen(key), 0); }
+    static uint64_t hash(const_string_view query) { return detail::wyhash(query.data(), query.size(), 0); }
+    static bool equal(const char *key, const_string_view query)
+    {
+        const char *q = query.data();
+        for (size_t i = 0; i < query.size(); i++)
+        {
+            if (key[i] != q[i])
+                return false;
+        }
+        return key[query.size()] == 0;
+    }
+};
+
+namespace detail
+{
+// not constexpr, reaching it in constant evaluation is a compile error
+inline void frozen_map_build_fail() {}
+} // namespace detail
+
+template <typename K, typename V> struct frozen_map_entry
+{
+    K key;
+    V value;
+};
+
+/// An immutable map built at compile time with a hash and displace perfect hash.
+/// Keys are grouped into N buckets by hash, every bucket owns a displacement
+/// which moves its keys into distinct slots. A lookup hashes once, reads the
+/// displacement and compares one slot, there are no chains and no allocation.
+///
+/// constexpr auto map = make_frozen_map<int, const char *>({{1, "EPERM"}, {2, "ENOENT"}});
+template <typename K, typename V, size_t N> class frozen_map
+{
+    using traits = frozen_key<K>;
+    using query_t = typename traits::query_t;
+    static_assert(N > 0);
+    static constexpr size_t slots = next_pow_of_2(N);
+    static constexpr uint32_t max_displacement = 1 << 16;
+
+  public:
+    consteval frozen_map(const frozen_map_entry<K, V> (&entries)[N])
+        : displacement_()
+        , used_()
+        , keys_()
+        , values_()
+    {
+        uint64_t hashes[N] = {};
+        size_t bucket_size[N] = {};
+        size_t max_size = 0;
+        for (size_t i = 0; i < N; i++)
+        {
+            hashes[i] = traits::hash(entries[i].key);
+            bucket_size[hashes[i] % N]++;
+            max_size = max(max_size, bucket_size[hashes[i] % N]);
+        }
+        // place the largest buckets first while the table is still empty
+        size_t members[N] = {};
+        size_t targets[N] = {};
+        for (size_t size = max_size; size > 0; size--)
+        {
+            for (size_t b = 0; b < N; b++)
+            {
+                if (bucket_size[b] != size)
+                    continue;
+                size_t count = 0;
+                for (size_t i = 0; i < N; i++)
+                {
+                    if (hashes[i] % N == b)
+                        members[count++] = i;
+                }
+                uint32_t d = 0;
+                for (; d < max_displacement; d++)
+                {
+                    bool ok = true;
+                    for (size_t j = 0; j < count && ok; j++)
+                    {
+                        targets[j] = slot_of(hashes[members[j]], d);
+                        ok = !used_[targets[j]];
+                        for (size_t k = 0; k < j && ok; k++)
+                        {
+                            ok = targets[k] != targets[j];
+                        }
+                    }
+                    if (ok)
+                        break;
+                }
+                if (d == max_displacement)
+                {
+                    detail::frozen_map_build_fail();
+                }
+                displacement_[b] = d;
+                for (size_t j = 0; j < count; j++)
+                {
+                    used_[targets[j]] = true;
+                    keys_[targets[j]] = entries[members[j]].key;
+                    values_[targets[j]] = entries[members[j]].value;
+                }
+            }
+        }
+    }
+
+    const V *get(const query_t &key) const
+    {
+        uint64_t hash = traits::hash(key);
+        size_t slot = slot_of(hash, displacement_[hash % N]);
+        if (used_[slot] && traits::equal(keys_[slot], key))
+        {
+            return &values_[slot];
+        }
+        return nullptr;
+    }
+
+    bool has(const query_t &key) const { return get(key) != nullptr; }
+
+    constexpr size_t size() const { return N; }
+
+  private:
+    uint32_t displacement_[N];
+    bool used_[slots];
+    K keys_[slots];
+    V values_[slots];
+
+    static constexpr size_t slot_of(uint64_t hash, uint32_t displacement)
+    {
+        return detail::fmix64(hash ^ (displacement * 0x9E3779B97F4A7C15)) & (slots - 1);
+    }
+};
+
+template <typename K, typename V, size_t N>
+consteval frozen_map<K, V, N> make_frozen_map(const frozen_map_entry<K, V> (&entries)[N])
+{
+    return frozen_map<K, V, N>(entries);
+}
+
+} // namespace freelibcxx
@@ -1,14 +1,19 @@
 #pragma once
+#include "freelibcxx/span.hpp"
+#include "freelibcxx/utils.hpp"
 #include <cstddef>
 #include <cstdint>
+#include <type_traits>
 namespace freelibcxx
 {
 namespace detail
 {
 
-uint32_t djb_hash(const char *str);
-size_t murmur_hash2_64(const void *key, size_t len, uint64_t seed);
+constexpr uint32_t djb_hash(const char *str);
+uint64_t murmur_hash2_64(const void *key, size_t len, uint64_t seed);
 void murmur_hash3_128(const void *key, const size_t len, const uint32_t seed, void *out);
+constexpr uint64_t fmix64(uint64_t k);
+uint64_t wyhash(const void *key, size_t len, uint64_t seed);
 } // namespace detail
 
 template <typename T> class hasher
@@ -16,37 +21,49 @@ template <typename T> class hasher
   public:
 };
 
-template <> struct hasher<unsigned long>
+/// Integral and enum keys are mixed in registers by the murmur3 finalizer
+template <typename T>
+requires std::is_integral_v<T> || std::is_enum_v<T>
+struct hasher<T>
 {
-    size_t operator()(const unsigned long &t) { return detail::murmur_hash2_64(&t, sizeof(unsigned long), 0); }
+    constexpr size_t operator()(const T &t) const
+    {
+        if constexpr (std::is_enum_v<T>)
+        {
+            return detail::fmix64(static_cast<uint64_t>(static_cast<std::underlying_type_t<T>>(t)));
+        }
+        else
+        {
+            return detail::fmix64(static_cast<uint64_t>(t));
+        }
+    }
 };
 
-template <> struct hasher<unsigned int>
+template <> struct hasher<unsigned __int128>
 {
-    size_t operator()(const unsigned int &t)
+    constexpr size_t operator()(const unsigned __int128 &t) const
     {
-        size_t k = t;
-        return detail::murmur_hash2_64(&k, sizeof(k), 0);
+        return detail::fmix64(static_cast<uint64_t>(t) ^ detail::fmix64(static_cast<uint64_t>(t >> 64)));
     }
 };
 
-template <> struct hasher<long>
+template <> struct hasher<__int128>
 {
-    size_t operator()(const long &t) { return detail::murmur_hash2_64(&t, sizeof(unsigned long), 0); }
+    constexpr size_t operator()(const __int128 &t) const
+    {
+        return hasher<unsigned __int128>()(static_cast<unsigned __int128>(t));
+    }
 };
 
-template <> struct hasher<int>
+template <typename T> struct hasher<T *>
 {
-    size_t operator()(const int &t)
-    {
-        size_t k = t;
-        return detail::murmur_hash2_64(&k, sizeof(k), 0);
-    }
+    size_t operator()(T *const &t) const { return detail::fmix64(reinterpret_cast<uintptr_t>(t)); }
 };
+
 namespace detail
 {
 
-inline uint32_t djb_hash(const char *str)
+constexpr uint32_t djb_hash(const char *str)
 {
     uint32_t hash = 5381;
 
@@ -58,14 +75,49 @@ inline uint32_t djb_hash(const char *str)
     return hash;
 }
 
+// Unaligned little-endian loads. Dereferencing a misaligned uint64_t pointer is
+// undefined behavior. Bytes are assembled one by one in constant evaluation.
+template <typename B>
+requires(sizeof(B) == 1) constexpr uint64_t read64(const B *p)
+{
+    if (std::is_constant_evaluated())
+    {
+        uint64_t v = 0;
+        for (int i = 0; i < 8; i++)
+        {
+            v |= (uint64_t)(uint8_t)p[i] << (i * 8);
+        }
+        return v;
+    }
+    uint64_t v;
+    __builtin_memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+template <typename B>
+requires(sizeof(B) == 1) constexpr uint32_t read32(const B *p)
+{
+    if (std::is_constant_evaluated())
+    {
+        uint32_t v = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            v |= (uint32_t)(uint8_t)p[i] << (i * 8);
+        }
+        return v;
+    }
+    uint32_t v;
+    __builtin_memcpy(&v, p, sizeof(v));
+    return v;
+}
+
 //-----------------------------------------------------------------------------
 // MurmurHash2 was written by Austin Appleby, and is placed in the public
 // domain. The author hereby disclaims copyright to this source code.
 
 // Note - This code makes a few assumptions about how your machine behaves -
 
-// 1. We can read a 4-byte value from any address without crashing
-// 2. sizeof(int) == 4
+// 1. sizeof(int) == 4
 
 // And it has a few limitations -
 
@@ -81,19 +133,20 @@ inline uint32_t djb_hash(const char *str)
 
 // 64-bit hash for 64-bit platforms
 
-inline uint64_t murmur_hash2_64(const void *key, size_t len, uint64_t seed)
+template <typename B> constexpr uint64_t murmur_hash2_64_bytes(const B *key, size_t len, uint64_t seed)
 {
     const uint64_t m = 0xc6a4a7935bd1e995;
     const int r = 47;
 
     uint64_t h = seed ^ (len * m);
 
-    const uint64_t *data = (const uint64_t *)key;
-    const uint64_t *end = data + (len / 8);
+    const B *data = key;
+    const B *end = data + (len / 8) * 8;
 
     while (data != end)
     {
-        uint64_t k = *data++;
+        uint64_t k = read64(data);
+        data += 8;
 
         k *= m;
         k ^= k >> r;
@@ -103,24 +156,24 @@ inline uint64_t murmur_hash2_64(const void *key, size_t len, uint64_t seed)
         h *= m;
     }
 
-    const unsigned char *data2 = (const unsigned char *)data;
+    const B *data2 = data;
 
     switch (len & 7)
     {
         case 7:
-            h ^= uint64_t(data2[6]) << 48;
+            h ^= uint64_t(uint8_t(data2[6])) << 48;
         case 6:
-            h ^= uint64_t(data2[5]) << 40;
+            h ^= uint64_t(uint8_t(data2[5])) << 40;
         case 5:
-            h ^= uint64_t(data2[4]) << 32;
+            h ^= uint64_t(uint8_t(data2[4])) << 32;
         case 4:
-            h ^= uint64_t(data2[3]) << 24;
+            h ^= uint64_t(uint8_t(data2[3])) << 24;
         case 3:
-            h ^= uint64_t(data2[2]) << 16;
+            h ^= uint64_t(uint8_t(data2[2])) << 16;
         case 2:
-            h ^= uint64_t(data2[1]) << 8;
+            h ^= uint64_t(uint8_t(data2[1])) << 8;
         case 1:
-            h ^= uint64_t(data2[0]);
+            h ^= uint64_t(uint8_t(data2[0]));
             h *= m;
     };
 
@@ -131,6 +184,16 @@ inline uint64_t murmur_hash2_64(const void *key, size_t len, uint64_t seed)
     return h;
 }
 
+inline uint64_t murmur_hash2_64(const void *key, size_t len, uint64_t seed)
+{
+    return murmur_hash2_64_bytes((const uint8_t *)key, len, seed);
+}
+
+constexpr uint64_t murmur_hash2_64(const char *key, size_t len, uint64_t seed)
+{
+    return murmur_hash2_64_bytes(key, len, seed);
+}
+
 //-----------------------------------------------------------------------------
 // MurmurHash3 was written by Austin Appleby, and is placed in the public
 // domain. The author hereby disclaims copyright to this source code.
@@ -144,9 +207,9 @@ inline uint32_t rotl32(uint32_t x, int8_t r) { return (x << r) | (x >> (32 - r))
 
 inline uint64_t rotl64(uint64_t x, int8_t r) { return (x << r) | (x >> (64 - r)); }
 
-inline uint32_t getblock32(const uint32_t *p, int i) { return p[i]; }
+inline uint32_t getblock32(const uint32_t *p, int i) { return read32((const uint8_t *)(p + i)); }
 
-inline uint64_t getblock64(const uint64_t *p, int i) { return p[i]; }
+inline uint64_t getblock64(const uint64_t *p, int i) { return read64((const uint8_t *)(p + i)); }
 
 //-----------------------------------------------------------------------------
 // Finalization mix - force all bits of a hash block to avalanche
@@ -164,7 +227,7 @@ inline uint32_t fmix32(uint32_t h)
 
 //----------
 
-inline uint64_t fmix64(uint64_t k)
+constexpr uint64_t fmix64(uint64_t k)
 {
     k ^= k >> 33;
     k *= 0xff51afd7ed558ccd;
@@ -175,23 +238,18 @@ inline uint64_t fmix64(uint64_t k)
     return k;
 }
 
-inline void murmur_hash3_128(const void *key, const uint64_t len, const uint32_t seed, void *out)
-{
-    const uint8_t *data = (const uint8_t *)key;
-    const int nblocks = len / 16;
-
-    uint64_t h1 = seed;
-    uint64_t h2 = seed;
+constexpr uint64_t murmur3_c1 = 0x87c37b91114253d5;
+constexpr uint64_t murmur3_c2 = 0x4cf5ad432745937f;
 
-    const uint64_t c1 = 0x87c37b91114253d5;
-    const uint64_t c2 = 0x4cf5ad432745937f;
-
-    //----------
-    // body
+// mix nblocks 16-byte blocks into h1, h2
+inline void murmur_hash3_128_body(uint64_t &h1, uint64_t &h2, const void *data, size_t nblocks)
+{
+    const uint64_t c1 = murmur3_c1;
+    const uint64_t c2 = murmur3_c2;
 
     const uint64_t *blocks = (const uint64_t *)(data);
 
-    for (int i = 0; i < nblocks; i++)
+    for (size_t i = 0; i < nblocks; i++)
     {
         uint64_t k1 = getblock64(blocks, i * 2 + 0);
         uint64_t k2 = getblock64(blocks, i * 2 + 1);
@@ -214,11 +272,15 @@ inline void murmur_hash3_128(const void *key, const uint64_t len, const uint32_t
         h2 += h1;
         h2 = h2 * 5 + 0x38495ab5;
     }
+}
 
-    //----------
-    // tail
+// mix the last len & 15 bytes and finalize
+inline void murmur_hash3_128_tail(uint64_t h1, uint64_t h2, const void *data, const uint64_t len, void *out)
+{
+    const uint64_t c1 = murmur3_c1;
+    const uint64_t c2 = murmur3_c2;
 
-    const uint8_t *tail = (const uint8_t *)(data + nblocks * 16);
+    const uint8_t *tail = (const uint8_t *)data;
 
     uint64_t k1 = 0;
     uint64_t k2 = 0;
@@ -284,5 +346,264 @@ inline void murmur_hash3_128(const void *key, const uint64_t len, const uint32_t
     ((uint64_t *)out)[0] = h1;
     ((uint64_t *)out)[1] = h2;
 }
+
+inline void murmur_hash3_128(const void *key, const uint64_t len, const uint32_t seed, void *out)
+{
+    const uint8_t *data = (const uint8_t *)key;
+    const size_t nblocks = len / 16;
+
+    uint64_t h1 = seed;
+    uint64_t h2 = seed;
+
+    //----------
+    // body
+
+    murmur_hash3_128_body(h1, h2, data, nblocks);
+
+    //----------
+    // tail
+
+    murmur_hash3_128_tail(h1, h2, data + nblocks * 16, len, out);
+}
+
+//-----------------------------------------------------------------------------
+// wyhash (final version 4) was written by Wang Yi, and is released into the
+// public domain. https://github.com/wangyi-fudan/wyhash
+
+// Each round mixes 16 bytes with a 64x64->128 bit multiply, three independent
+// lanes run over 48-byte stripes for long keys.
+
+constexpr uint64_t wyhash_secret[4] = {0x2d358dccaa6c78a5, 0x8bb84b93962eacc9, 0x4b33a62ed433d4a3,
+                                       0x4d5a2da51de1aa47};
+
+constexpr void wymum(uint64_t *a, uint64_t *b)
+{
+    unsigned __int128 r = *a;
+    r *= *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+}
+
+constexpr uint64_t wymix(uint64_t a, uint64_t b)
+{
+    wymum(&a, &b);
+    return a ^ b;
+}
+
+template <typename B> constexpr uint64_t wyr3(const B *p, size_t k)
+{
+    return (((uint64_t)(uint8_t)p[0]) << 16) | (((uint64_t)(uint8_t)p[k >> 1]) << 8) | (uint8_t)p[k - 1];
+}
+
+template <typename B> constexpr uint64_t wyhash_bytes(const B *p, size_t len, uint64_t seed)
+{
+    const uint64_t *secret = wyhash_secret;
+    seed ^= wymix(seed ^ secret[0], secret[1]);
+    uint64_t a, b;
+    if (len <= 16) [[likely]]
+    {
+        if (len >= 4) [[likely]]
+        {
+            a = ((uint64_t)read32(p) << 32) | read32(p + ((len >> 3) << 2));
+            b = ((uint64_t)read32(p + len - 4) << 32) | read32(p + len - 4 - ((len >> 3) << 2));
+        }
+        else if (len > 0) [[likely]]
+        {
+            a = wyr3(p, len);
+            b = 0;
+        }
+        else
+        {
+            a = b = 0;
+        }
+    }
+    else
+    {
+        size_t i = len;
+        if (i >= 48) [[unlikely]]
+        {
+            uint64_t see1 = seed, see2 = seed;
+            do
+            {
+                seed = wymix(read64(p) ^ secret[1], read64(p + 8) ^ seed);
+                see1 = wymix(read64(p + 16) ^ secret[2], read64(p + 24) ^ see1);
+                see2 = wymix(read64(p + 32) ^ secret[3], read64(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i >= 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) [[unlikely]]
+        {
+            seed = wymix(read64(p) ^ secret[1], read64(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = read64(p + i - 16);
+        b = read64(p + i - 8);
+    }
+    a ^= secret[1];
+    b ^= seed;
+    wymum(&a, &b);
+    return wymix(a ^ secret[0] ^ len, b ^ secret[1]);
+}
+
+inline uint64_t wyhash(const void *key, size_t len, uint64_t seed)
+{
+    return wyhash_bytes((const uint8_t *)key, len, seed);
+}
+
+constexpr uint64_t wyhash(const char *key, size_t len, uint64_t seed) { return wyhash_bytes(key, len, seed); }
 } // namespace detail
+
+/// Incremental murmur_hash3_128.
+/// Feeding the bytes in any chunks gives the same result as the one-shot function.
+class murmur3_128_state
+{
+  public:
+    explicit murmur3_128_state(uint32_t seed = 0)
+        : h1_(seed)
+        , h2_(seed)
+        , len_(0)
+        , buffered_(0)
+    {
+    }
+
+    void update(span<const std::byte> bytes) { update(bytes.get(), bytes.size()); }
+
+    void update(const void *data, size_t len)
+    {
+        const uint8_t *p = (const uint8_t *)data;
+        len_ += len;
+        if (buffered_ > 0)
+        {
+            size_t n = min(len, sizeof(buf_) - buffered_);
+            __builtin_memcpy(buf_ + buffered_, p, n);
+            buffered_ += n;
+            p += n;
+            len -= n;
+            if (buffered_ < sizeof(buf_))
+            {
+                return;
+            }
+            detail::murmur_hash3_128_body(h1_, h2_, buf_, 1);
+            buffered_ = 0;
+        }
+        size_t nblocks = len / 16;
+        detail::murmur_hash3_128_body(h1_, h2_, p, nblocks);
+        p += nblocks * 16;
+        buffered_ = len - nblocks * 16;
+        __builtin_memcpy(buf_, p, buffered_);
+    }
+
+    /// \param out 16 bytes output
+    void finish(void *out) const { detail::murmur_hash3_128_tail(h1_, h2_, buf_, len_, out); }
+
+  private:
+    uint64_t h1_;
+    uint64_t h2_;
+    uint64_t len_;
+    size_t buffered_;
+    uint8_t buf_[16];
+};
+
+/// Incremental wyhash.
+/// Feeding the bytes in any chunks gives the same result as the one-shot function.
+class wyhash_state
+{
+  public:
+    explicit wyhash_state(uint64_t seed = 0)
+        : seed0_(seed)
+        , len_(0)
+        , buffered_(0)
+        , striped_(false)
+    {
+        const uint64_t *secret = detail::wyhash_secret;
+        seed_ = seed ^ detail::wymix(seed ^ secret[0], secret[1]);
+        see1_ = seed_;
+        see2_ = seed_;
+    }
+
+    void update(span<const std::byte> bytes) { update(bytes.get(), bytes.size()); }
+
+    void update(const void *data, size_t len)
+    {
+        const uint8_t *p = (const uint8_t *)data;
+        len_ += len;
+        // a stripe is mixed once 48 bytes are known to be left, as the one-shot function does
+        if (buffered_ > 0)
+        {
+            size_t n = min(len, sizeof(buf_) - buffered_);
+            __builtin_memcpy(buf_ + buffered_, p, n);
+            buffered_ += n;
+            p += n;
+            len -= n;
+            if (buffered_ < sizeof(buf_))
+            {
+                return;
+            }
+            stripe(buf_);
+            buffered_ = 0;
+        }
+        while (len >= 48)
+        {
+            stripe(p);
+            p += 48;
+            len -= 48;
+        }
+        __builtin_memcpy(buf_, p, len);
+        buffered_ = len;
+    }
+
+    uint64_t finish() const
+    {
+        if (len_ <= 16)
+        {
+            return detail::wyhash(buf_, len_, seed0_);
+        }
+        const uint64_t *secret = detail::wyhash_secret;
+        uint64_t seed = seed_;
+        if (striped_)
+        {
+            seed ^= see1_ ^ see2_;
+        }
+        // the last 16 bytes may overlap the last stripe
+        uint8_t tail[16 + sizeof(buf_)];
+        __builtin_memcpy(tail, last_, 16);
+        __builtin_memcpy(tail + 16, buf_, buffered_);
+        const uint8_t *p = tail + 16;
+        size_t i = buffered_;
+        while (i > 16)
+        {
+            seed = detail::wymix(detail::read64(p) ^ secret[1], detail::read64(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        uint64_t a = detail::read64(p + i - 16) ^ secret[1];
+        uint64_t b = detail::read64(p + i - 8) ^ seed;
+        detail::wymum(&a, &b);
+        return detail::wymix(a ^ secret[0] ^ len_, b ^ secret[1]);
+    }
+
+  private:
+    uint64_t seed0_;
+    uint64_t seed_;
+    uint64_t see1_;
+    uint64_t see2_;
+    uint64_t len_;
+    size_t buffered_;
+    bool striped_;
+    uint8_t buf_[48];
+    uint8_t last_[16];
+
+    void stripe(const uint8_t *p)
+    {
+        const uint64_t *secret = detail::wyhash_secret;
+        seed_ = detail::wymix(detail::read64(p) ^ secret[1], detail::read64(p + 8) ^ seed_);
+        see1_ = detail::wymix(detail::read64(p + 16) ^ secret[2], detail::read64(p + 24) ^ see1_);
+        see2_ = detail::wymix(detail::read64(p + 32) ^ secret[3], detail::read64(p + 40) ^ see2_);
+        __builtin_memcpy(last_, p + 32, 16);
+        striped_ = true;
+    }
+};
 } // namespace freelibcxx
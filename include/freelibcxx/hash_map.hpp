@@ -1,9 +1,11 @@
 #pragma once
 #include "freelibcxx/algorithm.hpp"
 #include "freelibcxx/allocator.hpp"
+#include "freelibcxx/assert.hpp"
 #include "freelibcxx/hash.hpp"
 #include "freelibcxx/iterator.hpp"
 #include "freelibcxx/optional.hpp"
+#include "freelibcxx/span.hpp"
 #include "freelibcxx/utils.hpp"
 #include <type_traits>
 #include <utility>
@@ -16,6 +18,7 @@ template <typename K> struct hash_set_pair
     using Key = K;
     K key;
     template <typename... Args>
+    requires std::is_constructible_v<K, Args...>
     hash_set_pair(Args &&...args)
         : key(std::forward<Args>(args)...)
     {
@@ -101,12 +104,20 @@ template <typename P, typename hash_func> class base_hash_map
         base_forward_iterator<const_holder, value_fn<const_holder, const P *>, next_fn<const_holder>>;
     using iterator = base_forward_iterator<holder, value_fn<holder, P *>, next_fn<holder>>;
 
+    /// \param capacity The element count expected, the table is sized to hold it without rehash
     base_hash_map(Allocator *allocator, size_t capacity)
         : size_(0)
         , table_(nullptr)
         , cap_(0)
         , allocator_(allocator)
     {
+        reserve(capacity);
+    }
+
+    base_hash_map(Allocator *allocator, span<const P> items)
+        : base_hash_map(allocator, items.size())
+    {
+        build_from(items);
     }
 
     base_hash_map(Allocator *allocator, std::initializer_list<P> il)
@@ -160,6 +171,31 @@ template <typename P, typename hash_func> class base_hash_map
         return iterator(holder(&table_[hash], table_ + cap_, table_[hash].next));
     }
 
+    /// Insert a new element only if key is absent.
+    /// The key is hashed once and the chain is walked once.
+    ///
+    /// \return The element with key, and whether it was inserted
+    template <typename... Args> std::pair<iterator, bool> try_emplace(const K &key, Args &&...args)
+    {
+        size_t hash = hash_func()(key);
+        if (node_t *node = find_node(key, hash); node != nullptr)
+        {
+            return std::make_pair(make_iterator(hash, node), false);
+        }
+        return std::make_pair(make_iterator(hash, link_node(hash, key, std::forward<Args>(args)...)), true);
+    }
+
+    iterator find(const K &key)
+    {
+        size_t hash = hash_func()(key);
+        node_t *node = find_node(key, hash);
+        if (node == nullptr)
+        {
+            return end();
+        }
+        return make_iterator(hash, node);
+    }
+
     bool has(const K &key)
     {
         int count = key_count(key);
@@ -275,6 +311,55 @@ template <typename P, typename hash_func> class base_hash_map
 
     size_t capacity() const { return cap_; }
 
+    /// Grow the table so that element_count elements fit without rehash
+    void reserve(size_t element_count)
+    {
+        if (element_count == 0)
+        {
+            return;
+        }
+        size_t cap = table_capacity(element_count);
+        if (cap > cap_)
+        {
+            recapacity(cap);
+        }
+    }
+
+    void shrink_to_fit()
+    {
+        if (size_ == 0)
+        {
+            if (table_ != nullptr)
+            {
+                allocator_->DeleteArray(cap_, table_);
+                table_ = nullptr;
+                cap_ = 0;
+            }
+            return;
+        }
+        size_t cap = table_capacity(size_);
+        if (cap < cap_)
+        {
+            recapacity(cap);
+        }
+    }
+
+    /// Insert all items. The table is sized once and the nodes are linked
+    /// without load checks. Like insert, keys are not checked for duplication.
+    void build_from(span<const P> items)
+    {
+        reserve(size_ + items.size());
+        const P *data = items.get();
+        for (size_t i = 0; i < items.size(); i++)
+        {
+            node_t *node = allocator_->New<node_t>(nullptr, data[i]);
+            size_t index = hash_key(node->content.key);
+            node->next = table_[index].next;
+            table_[index].next = node;
+        }
+        size_ += items.size();
+    }
+
     iterator begin() const
     {
         auto table = this->table_;
@@ -332,11 +417,96 @@ template <typename P, typename hash_func> class base_hash_map
 
     size_t hash_key(const K &key) { return hash_func()(key) % cap_; }
 
+    /// \param hash The full hash value of key
+    node_t *find_node(const K &key, size_t hash) const
+    {
+        if (size_ == 0) [[unlikely]]
+        {
+            return nullptr;
+        }
+        for (auto it = table_[hash % cap_].next; it != nullptr; it = it->next)
+        {
+            if (it->content.key == key)
+                return it;
+        }
+        return nullptr;
+    }
+
+    /// Allocate and link a node without looking for duplicated keys.
+    /// The hash value is reused even if the table grows.
+    template <typename... Args> node_t *link_node(size_t hash, Args &&...args)
+    {
+        ensure(size_ + 1);
+        node_t *node = allocator_->New<node_t>(nullptr, std::forward<Args>(args)...);
+        size_t index = hash % cap_;
+        node->next = table_[index].next;
+        table_[index].next = node;
+        size_++;
+        return node;
+    }
+
+    static constexpr size_t probe_batch = 16;
+
+    /// Look up keys in batches. All keys of a batch are hashed and their buckets
+    /// prefetched before any chain is walked, so the cache misses overlap.
+    ///
+    /// \param fn Called as fn(index, node) for every key, node is nullptr if missing
+    template <typename F> void probe_many(span<const K> keys, F &&fn) const
+    {
+        const K *data = keys.get();
+        size_t n = keys.size();
+        if (size_ == 0) [[unlikely]]
+        {
+            for (size_t i = 0; i < n; i++)
+                fn(i, (node_t *)nullptr);
+            return;
+        }
+        const entry *buckets[probe_batch];
+        for (size_t base = 0; base < n; base += probe_batch)
+        {
+            size_t count = min(probe_batch, n - base);
+            for (size_t i = 0; i < count; i++)
+            {
+                buckets[i] = &table_[hash_func()(data[base + i]) % cap_];
+                __builtin_prefetch(buckets[i]);
+            }
+            for (size_t i = 0; i < count; i++)
+            {
+                if (buckets[i]->next != nullptr)
+                    __builtin_prefetch(buckets[i]->next);
+            }
+            for (size_t i = 0; i < count; i++)
+            {
+                const K &key = data[base + i];
+                node_t *node = buckets[i]->next;
+                while (node != nullptr && !(node->content.key == key))
+                    node = node->next;
+                fn(base + i, node);
+            }
+        }
+    }
+
+    iterator make_iterator(size_t hash, node_t *node)
+    {
+        return iterator(holder(&table_[hash % cap_], table_ + cap_, node));
+    }
+
+    // the load factor is 3/4, reserve and ensure share this bound
+    static bool over_load(size_t element_count, size_t cap) { return element_count * 4 > cap * 3; }
+
+    // smallest selected capacity which holds element_count within the load factor
+    static size_t table_capacity(size_t element_count)
+    {
+        size_t need = (element_count * 4 + 2) / 3;
+        size_t cap = select_capacity(need);
+        return cap < need ? need : cap;
+    }
+
     void ensure(size_t new_count)
     {
-        if (new_count >= cap_ * 75 / 100)
+        if (over_load(new_count, cap_))
         {
-            recapacity(select_capacity(max(cap_ + 1, new_count)));
+            recapacity(max(select_capacity(cap_ + 1), table_capacity(new_count)));
         }
     }
 
@@ -353,7 +523,7 @@ template <typename P, typename hash_func> class base_hash_map
     void copy(const base_hash_map &rhs)
     {
         allocator_ = rhs.allocator_;
-        cap_ = select_capacity(rhs.size_);
+        cap_ = table_capacity(rhs.size_);
         size_ = 0;
         table_ = allocator_->NewArray<entry>(cap_);
         auto iter = rhs.begin();
@@ -452,6 +622,56 @@ class hash_map : public base_hash_map<hash_map_pair<K, V>, hash_func>
         return nullopt;
     }
 
+    /// Insert key with value, or assign value to the existing element.
+    ///
+    /// \return The element with key, and whether it was inserted
+    template <typename M> std::pair<typename Parent::iterator, bool> insert_or_assign(const K &key, M &&value)
+    {
+        size_t hash = hash_func()(key);
+        if (auto node = this->find_node(key, hash); node != nullptr)
+        {
+            node->content.value = std::forward<M>(value);
+            return std::make_pair(this->make_iterator(hash, node), false);
+        }
+        auto node = this->link_node(hash, key, std::forward<M>(value));
+        return std::make_pair(this->make_iterator(hash, node), true);
+    }
+
+    /// Get the value of key. If key is absent, insert the value returned by factory.
+    /// factory is only invoked on a miss.
+    template <typename F> V &get_or_insert_with(const K &key, F &&factory)
+    {
+        size_t hash = hash_func()(key);
+        if (auto node = this->find_node(key, hash); node != nullptr)
+        {
+            return node->content.value;
+        }
+        return this->link_node(hash, key, factory())->content.value;
+    }
+
+    /// Batched get_ptr, see probe_many.
+    ///
+    /// \param values Output for each key, nullptr if missing. Size must be at least keys.size()
+    /// \return The count of keys found
+    size_t get_many(span<const K> keys, span<V *> values)
+    {
+        CXXASSERT(values.size() >= keys.size());
+        V **out = values.get();
+        size_t found = 0;
+        this->probe_many(keys, [out, &found](size_t index, typename Parent::node_t *node) {
+            if (node != nullptr)
+            {
+                out[index] = &node->content.value;
+                found++;
+            }
+            else
+            {
+                out[index] = nullptr;
+            }
+        });
+        return found;
+    }
+
     V *get_ptr(const K &key)
     {
         if (this->size_ == 0) [[unlikely]]
@@ -0,0 +1,314 @@
+#pragma once
+#include "freelibcxx/allocator.hpp"
+#include "freelibcxx/assert.hpp"
+#include "freelibcxx/function_ref.hpp"
+#include "freelibcxx/intrusive_rbtree.hpp"
+#include "freelibcxx/iterator.hpp"
+#include "freelibcxx/span.hpp"
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+namespace freelibcxx
+{
+
+/// Half open interval [start, end) with a value
+template <typename T, typename V> struct interval_entry
+{
+    T start;
+    T end;
+    V value;
+
+    template <typename... Args>
+    interval_entry(const T &start, const T &end, Args &&...args)
+        : start(start)
+        , end(end)
+        , value(std::forward<Args>(args)...)
+    {
+    }
+};
+
+template <typename T> struct interval_entry<T, void>
+{
+    T start;
+    T end;
+
+    interval_entry(const T &start, const T &end)
+        : start(start)
+        , end(end)
+    {
+    }
+};
+
+/// Half open intervals ordered by start, in an intrusive_rbtree augmented with the
+/// max end of every subtree. Overlapping and equal intervals are all kept.
+///
+/// Queries skip every subtree whose max end is not after the query start, and every
+/// right subtree once starts reach the query end, so reporting k intervals visits
+/// O(min(n, (k + 1) log n)) nodes. Start and end of an entry must not be changed, and
+/// callbacks must not modify the tree.
+template <typename T, typename V = void, typename Compare = std::less<T>> class interval_tree
+{
+  public:
+    using entry_t = interval_entry<T, V>;
+
+  private:
+    struct node_t : entry_t
+    {
+        T max_end;
+        rb_hook hook;
+
+        template <typename... Args>
+        node_t(const T &start, const T &end, Args &&...args)
+            : entry_t(start, end, std::forward<Args>(args)...)
+            , max_end(end)
+        {
+        }
+
+        explicit node_t(const entry_t &entry)
+            : entry_t(entry)
+            , max_end(entry.end)
+        {
+        }
+    };
+
+    struct node_less
+    {
+        Compare compare;
+
+        bool operator()(const node_t &a, const node_t &b) const { return compare(a.start, b.start); }
+        bool operator()(const node_t &a, const T &b) const { return compare(a.start, b); }
+        bool operator()(const T &a, const node_t &b) const { return compare(a, b.start); }
+    };
+
+    struct max_end_augment
+    {
+        Compare compare;
+
+        bool operator()(node_t &node, node_t *left, node_t *right) const
+        {
+            const T *max_end = &node.end;
+            if (left != nullptr && compare(*max_end, left->max_end))
+            {
+                max_end = &left->max_end;
+            }
+            if (right != nullptr && compare(*max_end, right->max_end))
+            {
+                max_end = &right->max_end;
+            }
+            if (!compare(node.max_end, *max_end) && !compare(*max_end, node.max_end))
+            {
+                return false;
+            }
+            node.max_end = *max_end;
+            return true;
+        }
+    };
+
+    using tree_t = intrusive_rbtree<node_t, &node_t::hook, node_less, max_end_augment>;
+
+    struct value_fn
+    {
+        entry_t *operator()(node_t *node) { return node; }
+    };
+    struct prev_fn
+    {
+        node_t *operator()(node_t *node) { return tree_t::prev(*node); }
+    };
+    struct next_fn
+    {
+        node_t *operator()(node_t *node) { return tree_t::next(*node); }
+    };
+
+  public:
+    using iterator = base_bidirectional_iterator<node_t *, value_fn, prev_fn, next_fn>;
+    using each_func = function_ref<void(entry_t &)>;
+
+    explicit interval_tree(Allocator *allocator, Compare compare = Compare())
+        : tree_(node_less{compare}, max_end_augment{compare})
+        , compare_(compare)
+        , allocator_(allocator)
+    {
+    }
+
+    interval_tree(const interval_tree &rhs)
+        : tree_(node_less{rhs.compare_}, max_end_augment{rhs.compare_})
+        , compare_(rhs.compare_)
+        , allocator_(rhs.allocator_)
+    {
+        copy(rhs);
+    }
+
+    interval_tree(interval_tree &&rhs) noexcept
+        : tree_(std::move(rhs.tree_))
+        , compare_(rhs.compare_)
+        , allocator_(rhs.allocator_)
+    {
+    }
+
+    ~interval_tree() { clear(); }
+
+    interval_tree &operator=(const interval_tree &rhs)
+    {
+        if (this == &rhs)
+            return *this;
+        clear();
+        allocator_ = rhs.allocator_;
+        copy(rhs);
+        return *this;
+    }
+
+    interval_tree &operator=(interval_tree &&rhs) noexcept
+    {
+        if (this == &rhs)
+            return *this;
+        clear();
+        tree_ = std::move(rhs.tree_);
+        compare_ = rhs.compare_;
+        allocator_ = rhs.allocator_;
+        return *this;
+    }
+
+    /// Insert [start, end), the value is constructed from args
+    template <typename... Args> iterator insert(const T &start, const T &end, Args &&...args)
+    {
+        CXXASSERT_MSG(!compare_(end, start), "interval end is before start");
+        node_t *node = allocator_->New<node_t>(start, end, std::forward<Args>(args)...);
+        tree_.insert(*node);
+        return iterator(node);
+    }
+
+    /// Remove the first interval equal to [start, end)
+    bool remove(const T &start, const T &end)
+    {
+        for (node_t *node = tree_.lower_find(start); node != nullptr && !compare_(start, node->start);
+             node = tree_t::next(*node))
+        {
+            if (!compare_(end, node->end) && !compare_(node->end, end))
+            {
+                tree_.remove(*node);
+                allocator_->Delete(node);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// \return The iterator after the removed interval
+    iterator remove(iterator iter)
+    {
+        node_t *node = iter.get();
+        node_t *next = tree_t::next(*node);
+        tree_.remove(*node);
+        allocator_->Delete(node);
+        return iterator(next);
+    }
+
+    /// The overlapping interval with the least start in O(log n)
+    ///
+    /// \return The interval, or nullptr if none overlaps [start, end)
+    entry_t *first_overlap(const T &start, const T &end)
+    {
+        if (!compare_(start, end))
+        {
+            return nullptr;
+        }
+        node_t *node = tree_.root();
+        while (node != nullptr && compare_(start, node->max_end))
+        {
+            // when the left subtree ends after start, an overlap is either there or nowhere
+            node_t *left = tree_t::left(*node);
+            if (left != nullptr && compare_(start, left->max_end))
+            {
+                node = left;
+                continue;
+            }
+            if (!compare_(node->start, end))
+            {
+                return nullptr;
+            }
+            if (compare_(start, node->end))
+            {
+                return node;
+            }
+            node = tree_t::right(*node);
+        }
+        return nullptr;
+    }
+
+    bool has_overlap(const T &start, const T &end) { return first_overlap(start, end) != nullptr; }
+
+    /// Call fn on every interval overlapping [start, end), by start
+    void for_each_overlap(const T &start, const T &end, each_func fn)
+    {
+        if (compare_(start, end))
+        {
+            visit<false>(tree_.root(), start, end, fn);
+        }
+    }
+
+    /// Call fn on every interval containing point, by start
+    void for_each_stab(const T &point, each_func fn) { visit<true>(tree_.root(), point, point, fn); }
+
+    /// Replace all intervals by entries sorted by start in O(n)
+    void build_sorted(span<const entry_t> entries)
+    {
+        clear();
+        const entry_t *src = entries.get();
+        size_t index = 0;
+        tree_.build_sorted(entries.size(), [&]() -> node_t & {
+            CXXASSERT_MSG(index == 0 || !compare_(src[index].start, src[index - 1].start), "entries are not sorted");
+            CXXASSERT_MSG(!compare_(src[index].end, src[index].start), "interval end is before start");
+            return *allocator_->New<node_t>(src[index++]);
+        });
+    }
+
+    void clear()
+    {
+        tree_.clear([this](node_t &node) { allocator_->Delete(&node); });
+    }
+
+    size_t size() const { return tree_.size(); }
+
+    bool empty() const { return tree_.empty(); }
+
+    iterator begin() const { return iterator(tree_.first()); }
+
+    iterator end() const { return iterator(nullptr); }
+
+  private:
+    tree_t tree_;
+    Compare compare_;
+    Allocator *allocator_;
+
+    void copy(const interval_tree &rhs)
+    {
+        node_t *src = rhs.tree_.first();
+        tree_.build_sorted(rhs.size(), [&]() -> node_t & {
+            node_t *node = allocator_->New<node_t>((const entry_t &)*src);
+            src = tree_t::next(*src);
+            return *node;
+        });
+    }
+
+    // Closed: start <= point, otherwise start < end
+    template <bool Closed> void visit(node_t *node, const T &start, const T &end, each_func &fn)
+    {
+        while (node != nullptr && compare_(start, node->max_end))
+        {
+            visit<Closed>(tree_t::left(*node), start, end, fn);
+            bool before_end = Closed ? !compare_(end, node->start) : compare_(node->start, end);
+            if (!before_end)
+            {
+                return;
+            }
+            if (compare_(start, node->end))
+            {
+                fn(*node);
+            }
+            node = tree_t::right(*node);
+        }
+    }
+};
+
+} // namespace freelibcxx
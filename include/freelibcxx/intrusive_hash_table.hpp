@@ -0,0 +1,316 @@
+#pragma once
+#include "freelibcxx/algorithm.hpp"
+#include "freelibcxx/allocator.hpp"
+#include "freelibcxx/assert.hpp"
+#include "freelibcxx/hash.hpp"
+#include "freelibcxx/iterator.hpp"
+#include "freelibcxx/span.hpp"
+#include "freelibcxx/utils.hpp"
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace freelibcxx
+{
+
+/// Link embedded in an object stored in intrusive_hash_table.
+/// An object may hold several hooks to live in several tables.
+struct hash_hook
+{
+    hash_hook *next = nullptr;
+    // the bucket head or the next field of the previous hook
+    hash_hook **pprev = nullptr;
+    size_t hash = 0;
+
+    bool is_linked() const { return pprev != nullptr; }
+};
+
+/// A chained hash table whose links live inside the elements.
+/// The table never owns, copies or allocates elements; only the bucket array
+/// is allocated. An element is unlinked in O(1) from its hook, without a lookup.
+///
+/// struct task { int pid; hash_hook hook; };
+/// struct task_pid { int operator()(const task &t) const { return t.pid; } };
+/// intrusive_hash_table<task, &task::hook, task_pid> tasks(allocator, 64);
+///
+/// \tparam KeyFn Functor returning the key of an element
+template <typename T, hash_hook T::*Hook, typename KeyFn,
+          typename hash_func = hasher<std::remove_cvref_t<decltype(KeyFn()(std::declval<const T &>()))>>>
+class intrusive_hash_table
+{
+    using K = std::remove_cvref_t<decltype(KeyFn()(std::declval<const T &>()))>;
+
+    template <typename E> struct base_holder
+    {
+        hash_hook **bucket;
+        hash_hook **end_bucket;
+        hash_hook *hook;
+        base_holder(hash_hook **bucket, hash_hook **end_bucket, hash_hook *hook)
+            : bucket(bucket)
+            , end_bucket(end_bucket)
+            , hook(hook)
+        {
+        }
+        bool operator==(const base_holder &rhs) const { return bucket == rhs.bucket && hook == rhs.hook; }
+        bool operator!=(const base_holder &rhs) const { return !operator==(rhs); }
+    };
+
+    template <typename H, typename E> struct value_fn
+    {
+        E operator()(H val) { return owner_of(val.hook); }
+    };
+    template <typename H> struct next_fn
+    {
+        H operator()(H val)
+        {
+            H holder = val;
+            holder.hook = holder.hook->next;
+            while (holder.hook == nullptr && ++holder.bucket < holder.end_bucket)
+            {
+                holder.hook = *holder.bucket;
+            }
+            return holder;
+        }
+    };
+
+    using holder = base_holder<T>;
+
+  public:
+    using iterator = base_forward_iterator<holder, value_fn<holder, T *>, next_fn<holder>>;
+
+    /// A table which grows its bucket array by allocator
+    ///
+    /// \param capacity The element count expected, the table is sized to hold it without rehash
+    explicit intrusive_hash_table(Allocator *allocator, size_t capacity = 0)
+        : buckets_(nullptr)
+        , cap_(0)
+        , size_(0)
+        , allocator_(allocator)
+    {
+        reserve(capacity);
+    }
+
+    /// A table on caller provided buckets, it never allocates and never grows
+    ///
+    /// \param buckets The bucket array, the size must be power of 2
+    explicit intrusive_hash_table(span<hash_hook *> buckets)
+        : buckets_(buckets.get())
+        , cap_(buckets.size())
+        , size_(0)
+        , allocator_(nullptr)
+    {
+        CXXASSERT(cap_ > 0 && is_pow_of_2(cap_));
+        for (size_t i = 0; i < cap_; i++)
+        {
+            buckets_[i] = nullptr;
+        }
+    }
+
+    /// Elements are unlinked, not destroyed
+    ~intrusive_hash_table()
+    {
+        clear();
+        if (allocator_ != nullptr && buckets_ != nullptr)
+        {
+            allocator_->DeleteArray(cap_, buckets_);
+        }
+    }
+
+    intrusive_hash_table(const intrusive_hash_table &) = delete;
+    intrusive_hash_table &operator=(const intrusive_hash_table &) = delete;
+
+    /// Link element if its key is absent
+    ///
+    /// \return false if the key exists, element is not linked
+    bool insert(T &element)
+    {
+        hash_hook *hook = &(element.*Hook);
+        CXXASSERT_MSG(!hook->is_linked(), "element is linked already");
+        const K &key = KeyFn()(element);
+        size_t hash = hash_func()(key);
+        if (find_hook(key, hash) != nullptr)
+        {
+            return false;
+        }
+        if (allocator_ != nullptr && size_ + 1 > cap_) [[unlikely]]
+        {
+            recapacity(next_pow_of_2(max(cap_ * 2, (size_t)8)));
+        }
+        hook->hash = hash;
+        link(hook);
+        size_++;
+        return true;
+    }
+
+    /// Link element, or replace the element with the same key
+    ///
+    /// \return The replaced element which is unlinked now, or nullptr
+    T *insert_or_replace(T &element)
+    {
+        T *old = remove(KeyFn()(element));
+        insert(element);
+        return old;
+    }
+
+    T *find(const K &key)
+    {
+        if (size_ == 0) [[unlikely]]
+        {
+            return nullptr;
+        }
+        hash_hook *hook = find_hook(key, hash_func()(key));
+        return hook != nullptr ? owner_of(hook) : nullptr;
+    }
+
+    bool has(const K &key) { return find(key) != nullptr; }
+
+    /// Unlink element in O(1), element must be linked in this table
+    void remove(T &element)
+    {
+        hash_hook *hook = &(element.*Hook);
+        CXXASSERT_MSG(hook->is_linked(), "element is not linked");
+        unlink(hook);
+        size_--;
+    }
+
+    /// Unlink the element with key
+    ///
+    /// \return The unlinked element, or nullptr
+    T *remove(const K &key)
+    {
+        T *element = find(key);
+        if (element != nullptr)
+        {
+            remove(*element);
+        }
+        return element;
+    }
+
+    /// Unlink all elements
+    void clear()
+    {
+        for (size_t i = 0; i < cap_ && size_ > 0; i++)
+        {
+            for (hash_hook *hook = buckets_[i]; hook != nullptr;)
+            {
+                hash_hook *next = hook->next;
+                hook->next = nullptr;
+                hook->pprev = nullptr;
+                hook = next;
+                size_--;
+            }
+            buckets_[i] = nullptr;
+        }
+    }
+
+    /// Grow the bucket array so that element_count elements fit without rehash
+    void reserve(size_t element_count)
+    {
+        CXXASSERT(allocator_ != nullptr);
+        if (element_count == 0)
+        {
+            return;
+        }
+        size_t cap = next_pow_of_2(element_count);
+        if (cap > cap_)
+        {
+            recapacity(cap);
+        }
+    }
+
+    size_t size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    size_t capacity() const { return cap_; }
+
+    iterator begin()
+    {
+        for (size_t i = 0; i < cap_ && size_ > 0; i++)
+        {
+            if (buckets_[i] != nullptr)
+            {
+                return iterator(holder(buckets_ + i, buckets_ + cap_, buckets_[i]));
+            }
+        }
+        return end();
+    }
+
+    iterator end() { return iterator(holder(buckets_ + cap_, buckets_ + cap_, nullptr)); }
+
+    /// The element which holds hook
+    static T *owner_of(hash_hook *hook)
+    {
+        size_t offset = (size_t)&(((T *)nullptr)->*Hook);
+        return (T *)((char *)hook - offset);
+    }
+
+  private:
+    hash_hook **buckets_;
+    size_t cap_;
+    size_t size_;
+    // null for caller provided buckets
+    Allocator *allocator_;
+
+    hash_hook *find_hook(const K &key, size_t hash)
+    {
+        if (cap_ == 0) [[unlikely]]
+        {
+            return nullptr;
+        }
+        for (hash_hook *hook = buckets_[hash & (cap_ - 1)]; hook != nullptr; hook = hook->next)
+        {
+            if (hook->hash == hash && KeyFn()(*owner_of(hook)) == key)
+            {
+                return hook;
+            }
+        }
+        return nullptr;
+    }
+
+    void link(hash_hook *hook)
+    {
+        hash_hook **head = &buckets_[hook->hash & (cap_ - 1)];
+        hook->next = *head;
+        if (*head != nullptr)
+        {
+            (*head)->pprev = &hook->next;
+        }
+        hook->pprev = head;
+        *head = hook;
+    }
+
+    static void unlink(hash_hook *hook)
+    {
+        *hook->pprev = hook->next;
+        if (hook->next != nullptr)
+        {
+            hook->next->pprev = hook->pprev;
+        }
+        hook->next = nullptr;
+        hook->pprev = nullptr;
+    }
+
+    void recapacity(size_t new_capacity)
+    {
+        hash_hook **old = buckets_;
+        size_t old_cap = cap_;
+        buckets_ = allocator_->NewArray<hash_hook *>(new_capacity, nullptr);
+        cap_ = new_capacity;
+        for (size_t i = 0; i < old_cap; i++)
+        {
+            for (hash_hook *hook = old[i]; hook != nullptr;)
+            {
+                hash_hook *next = hook->next;
+                link(hook);
+                hook = next;
+            }
+        }
+        if (old != nullptr)
+        {
+            allocator_->DeleteArray(old_cap, old);
+        }
+    }
+};
+
+} // namespace freelibcxx
@@ -0,0 +1,731 @@
+#pragma once
+#include "freelibcxx/assert.hpp"
+#include "freelibcxx/iterator.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+namespace freelibcxx
+{
+
+/// Link embedded in an object stored in intrusive_rbtree.
+/// The color is the low bit of the parent word, a linked node is never 0 there.
+struct rb_hook
+{
+    rb_hook *left = nullptr;
+    rb_hook *right = nullptr;
+    // parent | black
+    uintptr_t parent_color = 0;
+
+    bool is_linked() const { return parent_color != 0; }
+};
+
+/// Augment callback doing nothing
+struct rb_no_augment
+{
+    template <typename T> bool operator()(T &, T *, T *) const { return false; }
+};
+
+/// A red-black tree whose links live inside the elements.
+/// The tree never owns, copies or allocates elements. Equal elements are kept in
+/// insertion order. The leftmost element is cached for O(1) first() and pop_first().
+///
+/// Augment keeps a value computed from a subtree in every element, like Linux's
+/// rb_augment: `bool operator()(T &element, T *left, T *right)` recomputes it from the
+/// element and its children and returns whether it changed. The tree calls it bottom up
+/// along the changed path and on both nodes of every rotation.
+///
+/// struct vma { uintptr_t start; rb_hook hook; };
+/// struct vma_less { bool operator()(const vma &a, const vma &b) const { return a.start < b.start; } };
+/// intrusive_rbtree<vma, &vma::hook, vma_less> vmas;
+template <typename T, rb_hook T::*Hook, typename Compare = std::less<T>, typename Augment = rb_no_augment>
+class intrusive_rbtree
+{
+    static constexpr bool augmented = !std::is_same_v<Augment, rb_no_augment>;
+
+    template <typename E> struct value_fn
+    {
+        E operator()(rb_hook *hook) { return owner_of(hook); }
+    };
+    struct prev_fn
+    {
+        rb_hook *operator()(rb_hook *hook) { return prev_hook(hook); }
+    };
+    struct next_fn
+    {
+        rb_hook *operator()(rb_hook *hook) { return next_hook(hook); }
+    };
+
+  public:
+    using iterator = base_bidirectional_iterator<rb_hook *, value_fn<T *>, prev_fn, next_fn>;
+
+    explicit intrusive_rbtree(Compare compare = Compare(), Augment augment = Augment())
+        : root_(nullptr)
+        , leftmost_(nullptr)
+        , size_(0)
+        , compare_(std::move(compare))
+        , augment_(std::move(augment))
+    {
+    }
+
+    /// Elements are unlinked, not destroyed
+    ~intrusive_rbtree() { clear(); }
+
+    intrusive_rbtree(const intrusive_rbtree &) = delete;
+    intrusive_rbtree &operator=(const intrusive_rbtree &) = delete;
+
+    /// Elements stay in place, only the root moves
+    intrusive_rbtree(intrusive_rbtree &&rhs) noexcept
+        : root_(rhs.root_)
+        , leftmost_(rhs.leftmost_)
+        , size_(rhs.size_)
+        , compare_(std::move(rhs.compare_))
+        , augment_(std::move(rhs.augment_))
+    {
+        rhs.root_ = nullptr;
+        rhs.leftmost_ = nullptr;
+        rhs.size_ = 0;
+    }
+
+    intrusive_rbtree &operator=(intrusive_rbtree &&rhs) noexcept
+    {
+        if (this == &rhs)
+            return *this;
+        clear();
+        root_ = rhs.root_;
+        leftmost_ = rhs.leftmost_;
+        size_ = rhs.size_;
+        compare_ = std::move(rhs.compare_);
+        augment_ = std::move(rhs.augment_);
+        rhs.root_ = nullptr;
+        rhs.leftmost_ = nullptr;
+        rhs.size_ = 0;
+        return *this;
+    }
+
+    /// Link element after the elements equal to it
+    void insert(T &element)
+    {
+        rb_hook **link = &root_;
+        rb_hook *parent = nullptr;
+        bool leftmost = true;
+        while (*link != nullptr)
+        {
+            parent = *link;
+            if (compare_(element, *owner_of(parent)))
+            {
+                link = &parent->left;
+            }
+            else
+            {
+                link = &parent->right;
+                leftmost = false;
+            }
+        }
+        link_at(&(element.*Hook), parent, link, leftmost);
+    }
+
+    /// Link element if no equal element is linked
+    ///
+    /// \return false if an equal element exists, element is not linked
+    bool insert_unique(T &element)
+    {
+        rb_hook **link = &root_;
+        rb_hook *parent = nullptr;
+        bool leftmost = true;
+        while (*link != nullptr)
+        {
+            parent = *link;
+            T &current = *owner_of(parent);
+            if (compare_(element, current))
+            {
+                link = &parent->left;
+            }
+            else if (compare_(current, element))
+            {
+                link = &parent->right;
+                leftmost = false;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        link_at(&(element.*Hook), parent, link, leftmost);
+        return true;
+    }
+
+    /// Unlink element without a lookup, element must be linked in this tree
+    void remove(T &element)
+    {
+        rb_hook *hook = &(element.*Hook);
+        CXXASSERT_MSG(hook->is_linked(), "element is not linked");
+        erase(hook);
+    }
+
+    /// Unlink the first element
+    ///
+    /// \return The unlinked element, or nullptr if the tree is empty
+    T *pop_first()
+    {
+        if (leftmost_ == nullptr)
+        {
+            return nullptr;
+        }
+        rb_hook *hook = leftmost_;
+        erase(hook);
+        return owner_of(hook);
+    }
+
+    /// Find by a key, Compare must order keys and elements in both directions
+    ///
+    /// \return The first element equal to key, or nullptr
+    template <typename Key> T *find(const Key &key) const
+    {
+        T *element = lower_find(key);
+        if (element != nullptr && !compare_(key, *element))
+        {
+            return element;
+        }
+        return nullptr;
+    }
+
+    /// \return The first element not less than key, or nullptr
+    template <typename Key> T *lower_find(const Key &key) const
+    {
+        rb_hook *node = root_;
+        rb_hook *found = nullptr;
+        while (node != nullptr)
+        {
+            if (compare_(*owner_of(node), key))
+            {
+                node = node->right;
+            }
+            else
+            {
+                found = node;
+                node = node->left;
+            }
+        }
+        return found != nullptr ? owner_of(found) : nullptr;
+    }
+
+    /// \return The first element greater than key, or nullptr
+    template <typename Key> T *upper_find(const Key &key) const
+    {
+        rb_hook *node = root_;
+        rb_hook *found = nullptr;
+        while (node != nullptr)
+        {
+            if (compare_(key, *owner_of(node)))
+            {
+                found = node;
+                node = node->left;
+            }
+            else
+            {
+                node = node->right;
+            }
+        }
+        return found != nullptr ? owner_of(found) : nullptr;
+    }
+
+    template <typename Key> bool has(const Key &key) const { return find(key) != nullptr; }
+
+    T *first() const { return leftmost_ != nullptr ? owner_of(leftmost_) : nullptr; }
+
+    T *last() const
+    {
+        rb_hook *node = root_;
+        while (node != nullptr && node->right != nullptr)
+        {
+            node = node->right;
+        }
+        return node != nullptr ? owner_of(node) : nullptr;
+    }
+
+    static T *next(T &element)
+    {
+        rb_hook *hook = next_hook(&(element.*Hook));
+        return hook != nullptr ? owner_of(hook) : nullptr;
+    }
+
+    static T *prev(T &element)
+    {
+        rb_hook *hook = prev_hook(&(element.*Hook));
+        return hook != nullptr ? owner_of(hook) : nullptr;
+    }
+
+    /// The root and the children of an element, to walk the tree in augmented searches
+    T *root() const { return root_ != nullptr ? owner_of(root_) : nullptr; }
+
+    static T *left(T &element) { return owner_or_null((element.*Hook).left); }
+
+    static T *right(T &element) { return owner_or_null((element.*Hook).right); }
+
+    static T *parent(T &element) { return owner_or_null(parent_of(&(element.*Hook))); }
+
+    /// Replace all elements by count sorted elements in O(n)
+    ///
+    /// \param next Called count times, returns the elements in order
+    template <typename Next> void build_sorted(size_t count, Next next)
+    {
+        clear();
+        // the last level of a median split tree may be partial, color it red
+        int red_depth = 0;
+        while (((size_t)2 << red_depth) <= count + 1)
+        {
+            red_depth++;
+        }
+        root_ = build_range(count, 0, red_depth, next);
+        leftmost_ = root_;
+        while (leftmost_ != nullptr && leftmost_->left != nullptr)
+        {
+            leftmost_ = leftmost_->left;
+        }
+        size_ = count;
+    }
+
+    /// Unlink all elements in O(n)
+    void clear()
+    {
+        clear([](T &) {});
+    }
+
+    /// Unlink all elements in O(n)
+    ///
+    /// \param dispose Called on each element after it is unlinked, may free it
+    template <typename Dispose> void clear(Dispose dispose)
+    {
+        rb_hook *node = root_;
+        while (node != nullptr)
+        {
+            if (node->left != nullptr)
+            {
+                node = node->left;
+            }
+            else if (node->right != nullptr)
+            {
+                node = node->right;
+            }
+            else
+            {
+                rb_hook *parent = parent_of(node);
+                if (parent != nullptr)
+                {
+                    (parent->left == node ? parent->left : parent->right) = nullptr;
+                }
+                node->parent_color = 0;
+                dispose(*owner_of(node));
+                node = parent;
+            }
+        }
+        root_ = nullptr;
+        leftmost_ = nullptr;
+        size_ = 0;
+    }
+
+    size_t size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    iterator begin() const { return iterator(leftmost_); }
+
+    iterator end() const { return iterator(nullptr); }
+
+    /// The element which holds hook
+    static T *owner_of(rb_hook *hook)
+    {
+        size_t offset = (size_t)&(((T *)nullptr)->*Hook);
+        return (T *)((char *)hook - offset);
+    }
+
+  private:
+    rb_hook *root_;
+    rb_hook *leftmost_;
+    size_t size_;
+    Compare compare_;
+    Augment augment_;
+
+    static T *owner_or_null(rb_hook *hook) { return hook != nullptr ? owner_of(hook) : nullptr; }
+
+    static rb_hook *parent_of(rb_hook *node) { return (rb_hook *)(node->parent_color & ~(uintptr_t)1); }
+
+    static bool is_black(rb_hook *node) { return node == nullptr || (node->parent_color & 1); }
+
+    static bool is_red(rb_hook *node) { return !is_black(node); }
+
+    static void set_black(rb_hook *node) { node->parent_color |= 1; }
+
+    static void set_red(rb_hook *node) { node->parent_color &= ~(uintptr_t)1; }
+
+    static void set_parent(rb_hook *node, rb_hook *parent)
+    {
+        node->parent_color = (uintptr_t)parent | (node->parent_color & 1);
+    }
+
+    static void set_parent_color(rb_hook *node, rb_hook *parent, bool black)
+    {
+        node->parent_color = (uintptr_t)parent | black;
+    }
+
+    static rb_hook *next_hook(rb_hook *node)
+    {
+        if (node->right != nullptr)
+        {
+            node = node->right;
+            while (node->left != nullptr)
+            {
+                node = node->left;
+            }
+            return node;
+        }
+        rb_hook *parent = parent_of(node);
+        while (parent != nullptr && node == parent->right)
+        {
+            node = parent;
+            parent = parent_of(node);
+        }
+        return parent;
+    }
+
+    static rb_hook *prev_hook(rb_hook *node)
+    {
+        if (node->left != nullptr)
+        {
+            node = node->left;
+            while (node->right != nullptr)
+            {
+                node = node->right;
+            }
+            return node;
+        }
+        rb_hook *parent = parent_of(node);
+        while (parent != nullptr && node == parent->left)
+        {
+            node = parent;
+            parent = parent_of(node);
+        }
+        return parent;
+    }
+
+    bool compute(rb_hook *node)
+    {
+        return augment_(*owner_of(node), owner_or_null(node->left), owner_or_null(node->right));
+    }
+
+    // recompute from node up to stop, ancestors keep their value once a node does
+    void propagate(rb_hook *node, rb_hook *stop)
+    {
+        if constexpr (augmented)
+        {
+            while (node != stop && compute(node))
+            {
+                node = parent_of(node);
+            }
+        }
+    }
+
+    void replace_child(rb_hook *parent, rb_hook *old, rb_hook *node)
+    {
+        if (parent == nullptr)
+        {
+            root_ = node;
+        }
+        else if (parent->left == old)
+        {
+            parent->left = node;
+        }
+        else
+        {
+            parent->right = node;
+        }
+    }
+
+    // node moves down to the left, its right child takes its place
+    void rotate_left(rb_hook *node)
+    {
+        rb_hook *pivot = node->right;
+        rb_hook *parent = parent_of(node);
+        node->right = pivot->left;
+        if (pivot->left != nullptr)
+        {
+            set_parent(pivot->left, node);
+        }
+        pivot->left = node;
+        set_parent(pivot, parent);
+        replace_child(parent, node, pivot);
+        set_parent(node, pivot);
+        if constexpr (augmented)
+        {
+            compute(node);
+            compute(pivot);
+        }
+    }
+
+    void rotate_right(rb_hook *node)
+    {
+        rb_hook *pivot = node->left;
+        rb_hook *parent = parent_of(node);
+        node->left = pivot->right;
+        if (pivot->right != nullptr)
+        {
+            set_parent(pivot->right, node);
+        }
+        pivot->right = node;
+        set_parent(pivot, parent);
+        replace_child(parent, node, pivot);
+        set_parent(node, pivot);
+        if constexpr (augmented)
+        {
+            compute(node);
+            compute(pivot);
+        }
+    }
+
+    template <typename Next> rb_hook *build_range(size_t count, int depth, int red_depth, Next &next)
+    {
+        if (count == 0)
+        {
+            return nullptr;
+        }
+        size_t left_count = count / 2;
+        rb_hook *left = build_range(left_count, depth + 1, red_depth, next);
+        rb_hook *node = &(next().*Hook);
+        CXXASSERT_MSG(!node->is_linked(), "element is linked already");
+        rb_hook *right = build_range(count - left_count - 1, depth + 1, red_depth, next);
+        // the caller links the parent
+        node->parent_color = depth != red_depth;
+        node->left = left;
+        node->right = right;
+        if (left != nullptr)
+        {
+            set_parent(left, node);
+        }
+        if (right != nullptr)
+        {
+            set_parent(right, node);
+        }
+        if constexpr (augmented)
+        {
+            compute(node);
+        }
+        return node;
+    }
+
+    void link_at(rb_hook *node, rb_hook *parent, rb_hook **link, bool leftmost)
+    {
+        CXXASSERT_MSG(!node->is_linked(), "element is linked already");
+        node->left = nullptr;
+        node->right = nullptr;
+        set_parent_color(node, parent, false);
+        *link = node;
+        if (leftmost)
+        {
+            leftmost_ = node;
+        }
+        size_++;
+        if constexpr (augmented)
+        {
+            compute(node);
+            propagate(parent, nullptr);
+        }
+        insert_fixup(node);
+    }
+
+    void insert_fixup(rb_hook *node)
+    {
+        rb_hook *parent;
+        while (is_red(parent = parent_of(node)))
+        {
+            // a red parent is never the root
+            rb_hook *grand = parent_of(parent);
+            if (parent == grand->left)
+            {
+                rb_hook *uncle = grand->right;
+                if (is_red(uncle))
+                {
+                    set_black(parent);
+                    set_black(uncle);
+                    set_red(grand);
+                    node = grand;
+                    continue;
+                }
+                if (node == parent->right)
+                {
+                    rotate_left(parent);
+                    node = parent;
+                    parent = parent_of(node);
+                }
+                set_black(parent);
+                set_red(grand);
+                rotate_right(grand);
+            }
+            else
+            {
+                rb_hook *uncle = grand->left;
+                if (is_red(uncle))
+                {
+                    set_black(parent);
+                    set_black(uncle);
+                    set_red(grand);
+                    node = grand;
+                    continue;
+                }
+                if (node == parent->left)
+                {
+                    rotate_right(parent);
+                    node = parent;
+                    parent = parent_of(node);
+                }
+                set_black(parent);
+                set_red(grand);
+                rotate_left(grand);
+            }
+        }
+        set_black(root_);
+    }
+
+    void erase(rb_hook *node)
+    {
+        if (node == leftmost_)
+        {
+            leftmost_ = next_hook(node);
+        }
+        rb_hook *child;
+        rb_hook *child_parent;
+        bool black;
+        if (node->left == nullptr || node->right == nullptr)
+        {
+            child = node->left != nullptr ? node->left : node->right;
+            child_parent = parent_of(node);
+            black = is_black(node);
+            replace_child(child_parent, node, child);
+            if (child != nullptr)
+            {
+                set_parent(child, child_parent);
+            }
+            propagate(child_parent, nullptr);
+        }
+        else
+        {
+            // the successor takes the place and the color of node
+            rb_hook *successor = node->right;
+            while (successor->left != nullptr)
+            {
+                successor = successor->left;
+            }
+            black = is_black(successor);
+            child = successor->right;
+            if (parent_of(successor) == node)
+            {
+                child_parent = successor;
+            }
+            else
+            {
+                child_parent = parent_of(successor);
+                child_parent->left = child;
+                if (child != nullptr)
+                {
+                    set_parent(child, child_parent);
+                }
+                successor->right = node->right;
+                set_parent(node->right, successor);
+            }
+            successor->left = node->left;
+            set_parent(node->left, successor);
+            rb_hook *parent = parent_of(node);
+            replace_child(parent, node, successor);
+            set_parent_color(successor, parent, is_black(node));
+            if constexpr (augmented)
+            {
+                propagate(child_parent, successor);
+                compute(successor);
+                propagate(parent, nullptr);
+            }
+        }
+        node->left = nullptr;
+        node->right = nullptr;
+        node->parent_color = 0;
+        size_--;
+        if (black)
+        {
+            erase_fixup(child, child_parent);
+        }
+    }
+
+    // child has one black less than its sibling
+    void erase_fixup(rb_hook *child, rb_hook *parent)
+    {
+        while (child != root_ && is_black(child))
+        {
+            if (child == parent->left)
+            {
+                rb_hook *sibling = parent->right;
+                if (is_red(sibling))
+                {
+                    set_black(sibling);
+                    set_red(parent);
+                    rotate_left(parent);
+                    sibling = parent->right;
+                }
+                if (is_black(sibling->left) && is_black(sibling->right))
+                {
+                    set_red(sibling);
+                    child = parent;
+                    parent = parent_of(child);
+                    continue;
+                }
+                if (is_black(sibling->right))
+                {
+                    set_black(sibling->left);
+                    set_red(sibling);
+                    rotate_right(sibling);
+                    sibling = parent->right;
+                }
+                set_parent_color(sibling, parent_of(sibling), is_black(parent));
+                set_black(parent);
+                set_black(sibling->right);
+                rotate_left(parent);
+            }
+            else
+            {
+                rb_hook *sibling = parent->left;
+                if (is_red(sibling))
+                {
+                    set_black(sibling);
+                    set_red(parent);
+                    rotate_right(parent);
+                    sibling = parent->left;
+                }
+                if (is_black(sibling->left) && is_black(sibling->right))
+                {
+                    set_red(sibling);
+                    child = parent;
+                    parent = parent_of(child);
+                    continue;
+                }
+                if (is_black(sibling->left))
+                {
+                    set_black(sibling->right);
+                    set_red(sibling);
+                    rotate_left(sibling);
+                    sibling = parent->left;
+                }
+                set_parent_color(sibling, parent_of(sibling), is_black(parent));
+                set_black(parent);
+                set_black(sibling->left);
+                rotate_right(parent);
+            }
+            child = root_;
+        }
+        if (child != nullptr)
+        {
+            set_black(child);
+        }
+    }
+};
+
+} // namespace freelibcxx
@@ -0,0 +1,514 @@
+#pragma once
+#include "freelibcxx/algorithm.hpp"
+#include "freelibcxx/allocator.hpp"
+#include "freelibcxx/assert.hpp"
+#include "freelibcxx/hash.hpp"
+#include "freelibcxx/hash_map.hpp"
+#include "freelibcxx/iterator.hpp"
+#include "freelibcxx/optional.hpp"
+#include "freelibcxx/vector.hpp"
+#include <cstdint>
+#include <initializer_list>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace freelibcxx
+{
+
+/// A hash map which keeps elements in insertion order.
+/// Elements live in a dense vector, the hash index is an open addressing table of
+/// 32 bit positions into it, each with the low 32 bits of the hash as a tag. Removed
+/// elements leave a hole which iteration skips, and holes are compacted when the index
+/// is rebuilt or when they outnumber the elements, so positions are stable until then.
+template <typename P, typename hash_func> class base_ordered_hash_map
+{
+  protected:
+    using K = typename P::Key;
+    static constexpr uint32_t empty_slot = (uint32_t)-1;
+
+    struct entry_t
+    {
+        union
+        {
+            P pair;
+        };
+        bool live;
+
+        template <typename... Args>
+        requires std::is_constructible_v<P, Args...>
+        entry_t(Args &&...args)
+            : pair(std::forward<Args>(args)...)
+            , live(true)
+        {
+        }
+
+        entry_t(const entry_t &rhs)
+            : live(rhs.live)
+        {
+            if (live)
+            {
+                new (&pair) P(rhs.pair);
+            }
+        }
+
+        entry_t(entry_t &&rhs) noexcept(std::is_nothrow_move_constructible_v<P>)
+            : live(rhs.live)
+        {
+            if (live)
+            {
+                new (&pair) P(std::move(rhs.pair));
+            }
+        }
+
+        entry_t &operator=(const entry_t &rhs)
+        {
+            if (this != &rhs)
+            {
+                kill();
+                live = rhs.live;
+                if (live)
+                {
+                    new (&pair) P(rhs.pair);
+                }
+            }
+            return *this;
+        }
+
+        entry_t &operator=(entry_t &&rhs) noexcept(std::is_nothrow_move_constructible_v<P>)
+        {
+            if (this != &rhs)
+            {
+                kill();
+                live = rhs.live;
+                if (live)
+                {
+                    new (&pair) P(std::move(rhs.pair));
+                }
+            }
+            return *this;
+        }
+
+        ~entry_t() { kill(); }
+
+        void kill()
+        {
+            if (live)
+            {
+                pair.~P();
+                live = false;
+            }
+        }
+    };
+
+    struct slot_t
+    {
+        uint32_t pos;
+        uint32_t tag;
+    };
+
+    template <typename E> struct holder_t
+    {
+        E *entry;
+        E *end;
+
+        bool operator==(const holder_t &rhs) const { return entry == rhs.entry; }
+        bool operator!=(const holder_t &rhs) const { return entry != rhs.entry; }
+    };
+
+    template <typename H, typename R> struct value_fn
+    {
+        R operator()(H holder) { return &holder.entry->pair; }
+    };
+
+    template <typename H> struct next_fn
+    {
+        H operator()(H holder) { return skip(H{holder.entry + 1, holder.end}); }
+    };
+
+    template <typename H> static H skip(H holder)
+    {
+        while (holder.entry != holder.end && !holder.entry->live)
+        {
+            holder.entry++;
+        }
+        return holder;
+    }
+
+    using holder = holder_t<entry_t>;
+    using const_holder = holder_t<const entry_t>;
+
+  public:
+    using iterator = base_forward_iterator<holder, value_fn<holder, P *>, next_fn<holder>>;
+    using const_iterator =
+        base_forward_iterator<const_holder, value_fn<const_holder, const P *>, next_fn<const_holder>>;
+
+    explicit base_ordered_hash_map(Allocator *allocator)
+        : entries_(allocator)
+        , index_(allocator)
+        , dead_(0)
+    {
+    }
+
+    base_ordered_hash_map(Allocator *allocator, size_t capacity)
+        : base_ordered_hash_map(allocator)
+    {
+        reserve(capacity);
+    }
+
+    base_ordered_hash_map(Allocator *allocator, std::initializer_list<P> il)
+        : base_ordered_hash_map(allocator, il.size())
+    {
+        for (const P &e : il)
+        {
+            size_t hash = hash_func()(e.key);
+            size_t slot = probe(e.key, hash);
+            if (slot == (size_t)-1 || index_[slot].pos == empty_slot)
+            {
+                append(hash, e);
+            }
+        }
+    }
+
+    /// Append a new element only if key is absent
+    ///
+    /// \return The element with key, and whether it was inserted
+    template <typename... Args> std::pair<iterator, bool> insert(const K &key, Args &&...args)
+    {
+        size_t hash = hash_func()(key);
+        size_t slot = probe(key, hash);
+        if (slot != (size_t)-1 && index_[slot].pos != empty_slot)
+        {
+            return std::make_pair(iterator_at(index_[slot].pos), false);
+        }
+        return std::make_pair(append(hash, key, std::forward<Args>(args)...), true);
+    }
+
+    iterator find(const K &key)
+    {
+        size_t pos = position_of(key);
+        if (pos == (size_t)-1)
+        {
+            return end();
+        }
+        return iterator_at(pos);
+    }
+
+    bool has(const K &key) { return position_of(key) != (size_t)-1; }
+
+    /// \return The position of key, or -1. Positions grow in insertion order and
+    /// change only when the holes of removed elements are compacted
+    size_t position_of(const K &key)
+    {
+        size_t hash = hash_func()(key);
+        size_t slot = probe(key, hash);
+        if (slot == (size_t)-1 || index_[slot].pos == empty_slot)
+        {
+            return (size_t)-1;
+        }
+        return index_[slot].pos;
+    }
+
+    /// Remove key and keep the order of other elements, amortized O(1)
+    bool remove(const K &key)
+    {
+        size_t hash = hash_func()(key);
+        size_t slot = probe(key, hash);
+        if (slot == (size_t)-1 || index_[slot].pos == empty_slot)
+        {
+            return false;
+        }
+        uint32_t pos = index_[slot].pos;
+        erase_slot(slot);
+        entries_[pos].kill();
+        dead_++;
+        trim();
+        return true;
+    }
+
+    /// Remove key in O(1), the last element is moved into its position
+    bool swap_remove(const K &key)
+    {
+        size_t hash = hash_func()(key);
+        size_t slot = probe(key, hash);
+        if (slot == (size_t)-1 || index_[slot].pos == empty_slot)
+        {
+            return false;
+        }
+        uint32_t pos = index_[slot].pos;
+        erase_slot(slot);
+        // the last entry is always live
+        uint32_t last = entries_.size() - 1;
+        if (pos != last)
+        {
+            index_[slot_of_position(last)].pos = pos;
+            entries_[pos].pair = std::move(entries_[last].pair);
+        }
+        entries_.truncate(last);
+        trim();
+        return true;
+    }
+
+    void reserve(size_t element_count)
+    {
+        entries_.ensure(element_count);
+        size_t cap = next_pow_of_2(element_count * 4 / 3 + 1);
+        if (cap > index_.size())
+        {
+            rebuild(cap);
+        }
+    }
+
+    void clear()
+    {
+        entries_.clear();
+        dead_ = 0;
+        for (size_t i = 0; i < index_.size(); i++)
+        {
+            index_[i].pos = empty_slot;
+        }
+    }
+
+    size_t size() const { return entries_.size() - dead_; }
+
+    bool empty() const { return size() == 0; }
+
+    size_t capacity() const { return index_.size(); }
+
+    /// The element at a position returned by position_of
+    P &at(size_t position)
+    {
+        CXXASSERT(entries_.at(position).live);
+        return entries_.at(position).pair;
+    }
+
+    const P &at(size_t position) const
+    {
+        CXXASSERT(entries_.at(position).live);
+        return entries_.at(position).pair;
+    }
+
+    iterator begin() { return iterator_at(0); }
+
+    iterator end()
+    {
+        entry_t *end = entries_.data() + entries_.size();
+        return iterator(holder{end, end});
+    }
+
+    const_iterator begin() const
+    {
+        const entry_t *entries = entries_.data();
+        return const_iterator(skip(const_holder{entries, entries + entries_.size()}));
+    }
+
+    const_iterator end() const
+    {
+        const entry_t *end = entries_.data() + entries_.size();
+        return const_iterator(const_holder{end, end});
+    }
+
+  protected:
+    base_vector<entry_t> entries_;
+    // the size is a power of 2
+    base_vector<slot_t> index_;
+    // holes in entries_
+    size_t dead_;
+
+    size_t mask() const { return index_.size() - 1; }
+
+    iterator iterator_at(size_t pos)
+    {
+        entry_t *entries = entries_.data();
+        return iterator(skip(holder{entries + pos, entries + entries_.size()}));
+    }
+
+    /// \return The slot holding key, or the empty slot ending the probe, or -1 if there is no table
+    size_t probe(const K &key, size_t hash)
+    {
+        if (index_.size() == 0) [[unlikely]]
+        {
+            return (size_t)-1;
+        }
+        uint32_t tag = hash;
+        size_t slot = hash & mask();
+        while (index_[slot].pos != empty_slot)
+        {
+            if (index_[slot].tag == tag && entries_[index_[slot].pos].pair.key == key)
+            {
+                break;
+            }
+            slot = (slot + 1) & mask();
+        }
+        return slot;
+    }
+
+    size_t slot_of_position(uint32_t pos)
+    {
+        size_t slot = hash_func()(entries_[pos].pair.key) & mask();
+        while (index_[slot].pos != pos)
+        {
+            slot = (slot + 1) & mask();
+        }
+        return slot;
+    }
+
+    // args construct the new element
+    template <typename... Args> iterator append(size_t hash, Args &&...args)
+    {
+        CXXASSERT(entries_.size() < empty_slot);
+        if ((size() + 1) * 4 > index_.size() * 3)
+        {
+            rebuild(max(index_.size() * 2, (size_t)8));
+        }
+        uint32_t pos = entries_.size();
+        entries_.push_back(std::forward<Args>(args)...);
+        size_t slot = hash & mask();
+        while (index_[slot].pos != empty_slot)
+        {
+            slot = (slot + 1) & mask();
+        }
+        index_[slot] = slot_t{pos, (uint32_t)hash};
+        return iterator_at(pos);
+    }
+
+    // backward shift deletion, no tombstones are left in the index
+    void erase_slot(size_t slot)
+    {
+        size_t hole = slot;
+        size_t next = slot;
+        for (;;)
+        {
+            next = (next + 1) & mask();
+            if (index_[next].pos == empty_slot)
+            {
+                break;
+            }
+            size_t ideal = index_[next].tag & mask();
+            // move next into the hole if its ideal slot is not in (hole, next]
+            if (((next - ideal) & mask()) >= ((next - hole) & mask()))
+            {
+                index_[hole] = index_[next];
+                hole = next;
+            }
+        }
+        index_[hole].pos = empty_slot;
+    }
+
+    // keep the last entry live and the holes fewer than the elements
+    void trim()
+    {
+        size_t count = entries_.size();
+        while (count > 0 && !entries_[count - 1].live)
+        {
+            count--;
+            dead_--;
+        }
+        entries_.truncate(count);
+        if (dead_ * 2 > entries_.size())
+        {
+            rebuild(index_.size());
+        }
+    }
+
+    // compact the holes and rehash into cap slots from the tags
+    void rebuild(size_t cap)
+    {
+        base_vector<uint32_t> moved_to(entries_.allocator());
+        if (dead_ > 0)
+        {
+            moved_to.expand(entries_.size(), (uint32_t)empty_slot);
+            uint32_t to = 0;
+            for (uint32_t from = 0; from < entries_.size(); from++)
+            {
+                if (entries_[from].live)
+                {
+                    moved_to[from] = to;
+                    if (from != to)
+                    {
+                        entries_[to] = std::move(entries_[from]);
+                    }
+                    to++;
+                }
+            }
+            entries_.truncate(to);
+            dead_ = 0;
+        }
+        base_vector<slot_t> index(index_.allocator());
+        index.expand(cap, slot_t{empty_slot, 0});
+        for (size_t i = 0; i < index_.size(); i++)
+        {
+            slot_t s = index_[i];
+            if (s.pos == empty_slot)
+            {
+                continue;
+            }
+            if (!moved_to.empty())
+            {
+                s.pos = moved_to[s.pos];
+            }
+            size_t slot = s.tag & (cap - 1);
+            while (index[slot].pos != empty_slot)
+            {
+                slot = (slot + 1) & (cap - 1);
+            }
+            index[slot] = s;
+        }
+        index_ = std::move(index);
+    }
+};
+
+template <typename K, typename V, typename hash_func = hasher<K>>
+class ordered_hash_map : public base_ordered_hash_map<hash_map_pair<K, V>, hash_func>
+{
+    using Parent = base_ordered_hash_map<hash_map_pair<K, V>, hash_func>;
+
+  public:
+    using Parent::Parent;
+
+    optional<V> get(const K &key)
+    {
+        V *v = get_ptr(key);
+        if (v == nullptr)
+        {
+            return nullopt;
+        }
+        return *v;
+    }
+
+    V *get_ptr(const K &key)
+    {
+        size_t pos = this->position_of(key);
+        if (pos == (size_t)-1)
+        {
+            return nullptr;
+        }
+        return &this->entries_[pos].pair.value;
+    }
+
+    /// Insert key with value, or assign value to the existing element.
+    /// An assigned element keeps its position.
+    template <typename M> std::pair<typename Parent::iterator, bool> insert_or_assign(const K &key, M &&value)
+    {
+        size_t hash = hash_func()(key);
+        size_t slot = this->probe(key, hash);
+        if (slot != (size_t)-1 && this->index_[slot].pos != Parent::empty_slot)
+        {
+            auto it = this->iterator_at(this->index_[slot].pos);
+            it->value = std::forward<M>(value);
+            return std::make_pair(it, false);
+        }
+        return std::make_pair(this->append(hash, key, std::forward<M>(value)), true);
+    }
+};
+
+template <typename K, typename hash_func = hasher<K>>
+class ordered_hash_set : public base_ordered_hash_map<hash_set_pair<K>, hash_func>
+{
+    using Parent = base_ordered_hash_map<hash_set_pair<K>, hash_func>;
+
+  public:
+    using Parent::Parent;
+};
+
+} // namespace freelibcxx
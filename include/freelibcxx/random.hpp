@@ -9,6 +9,17 @@ namespace detail
 constexpr uint32_t xor_64bits(uint64_t val) { return ((uint32_t)val) ^ ((uint32_t)(val << 32)); }
 } // namespace detail
 
+/// Level of a skip list node from one random draw, every PROMOTE_BITS trailing zero
+/// bits are one more level, so a node reaches the next level with chance 1 / 2^PROMOTE_BITS
+///
+/// \return level in [0, MAXLEVEL)
+template <int MAXLEVEL, int PROMOTE_BITS = 1> constexpr int geometric_level(uint64_t r)
+{
+    static_assert(MAXLEVEL > 0 && PROMOTE_BITS > 0 && PROMOTE_BITS <= 4);
+    int level = __builtin_ctzll(r | (1ULL << 63)) / PROMOTE_BITS;
+    return level < MAXLEVEL - 1 ? level : MAXLEVEL - 1;
+}
+
 template <typename E> class random_generator
 {
   public:
@@ -77,6 +88,21 @@ class linear_random_engine
     static linear_random_engine global_;
 };
 
+// output 64bits, the whole state is one word
+class xorshift_random_engine
+{
+  public:
+    xorshift_random_engine(uint64_t seed) { update_seed(seed); }
+
+    void update_seed(uint64_t seed);
+    uint64_t operator()();
+
+    uint64_t pick() const { return state_; };
+
+  private:
+    uint64_t state_;
+};
+
 inline constexpr void mt19937_random_engine::init(uint64_t seed)
 {
     state_[0] = detail::xor_64bits(seed);
@@ -122,4 +148,18 @@ inline uint64_t linear_random_engine::operator()()
     return (ret0 | ((uint64_t)ret1 << 30)) & 0xFFFF'FFFF;
 }
 
+// state must not be 0
+inline void xorshift_random_engine::update_seed(uint64_t seed) { state_ = seed == 0 ? 0x9E3779B97F4A7C15 : seed; }
+
+// https://en.wikipedia.org/wiki/Xorshift#xorshift*
+inline uint64_t xorshift_random_engine::operator()()
+{
+    uint64_t x = state_;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    state_ = x;
+    return x * 0x2545F4914F6CDD1D;
+}
+
 } // namespace freelibcxx
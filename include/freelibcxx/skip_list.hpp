@@ -1,15 +1,21 @@
 #pragma once
 #include "freelibcxx/allocator.hpp"
+#include "freelibcxx/assert.hpp"
+#include "freelibcxx/function_ref.hpp"
 #include "freelibcxx/iterator.hpp"
 #include "freelibcxx/random.hpp"
+#include "freelibcxx/span.hpp"
 #include <cstddef>
 #include <functional>
 #include <utility>
 
 namespace freelibcxx
 {
-template <typename E, typename RDENG = mt19937_random_engine, int MAXLEVEL = 20> class skip_list
+/// PROMOTE_BITS sets the chance a node reaches the next level to 1 / 2^PROMOTE_BITS
+template <typename E, typename RDENG = xorshift_random_engine, int MAXLEVEL = 20, int PROMOTE_BITS = 1> class skip_list
 {
+    static_assert(PROMOTE_BITS > 0 && PROMOTE_BITS <= 4);
+
   public:
     struct node_t;
     using list_node = node_t;
@@ -33,11 +39,7 @@ template <typename E, typename RDENG = mt19937_random_engine, int MAXLEVEL = 20>
 
   public:
     using const_iterator = base_bidirectional_iterator<CE, value_fn<CE, const E *>, prev_fn<CE>, next_fn<CE>>;
-    using iterator = base_bidirectional_iterator<NE, value_fn<NE, E *>, prev_fn<CE>, next_fn<NE>>;
-    /// return -1 walk left
-    /// 1 walk right
-    /// 0 stop
-    typedef int (*each_func)(const E &element, size_t user_data);
+    using iterator = base_bidirectional_iterator<NE, value_fn<NE, E *>, prev_fn<NE>, next_fn<NE>>;
 
     skip_list(Allocator *allocator, uint64_t seed = 0)
         : count_(0)
@@ -53,7 +55,7 @@ template <typename E, typename RDENG = mt19937_random_engine, int MAXLEVEL = 20>
     {
         for (const E &e : il)
         {
-            insert(e);
+            insert_hint(end(), e);
         }
     }
 
@@ -92,61 +94,73 @@ template <typename E, typename RDENG = mt19937_random_engine, int MAXLEVEL = 20>
     template <typename... Args> iterator insert(Args &&...args)
     {
         int node_level = this->rand();
-        int cur_level = level_;
-
-        if (node_level > cur_level)
-        {
-            cur_level = node_level;
-        }
-        int level = cur_level;
+        auto insert_node = make_node(node_level + 1, std::forward<Args>(args)...);
+        node_t *cache_nodes[MAXLEVEL];
+        search(insert_node->element_, node_level > level_ ? node_level : level_, cache_nodes);
+        return link(insert_node, node_level, cache_nodes);
+    }
 
-        auto node = node_;
+    /// Insert with an append hint: hint is the position right after the last inserted
+    /// element, end() while elements come in ascending order. When the element belongs
+    /// there the cached path of the last insert is linked without any search, otherwise
+    /// this is insert. Either way an equal element goes before the existing ones, as in insert
+    template <typename... Args> iterator insert_hint(iterator hint, Args &&...args)
+    {
+        int node_level = this->rand();
+        int top = node_level > level_ ? node_level : level_;
         auto insert_node = make_node(node_level + 1, std::forward<Args>(args)...);
         node_t *cache_nodes[MAXLEVEL];
-        // for each level of node
-        // find the element path
-        while (cur_level >= 0)
+        node_t *prev = finger_[0];
+        node_t *next = hint.get();
+        if (prev->level_[0].next_ == next && (prev == node_ || prev->element_ < insert_node->element_) &&
+            (next == nullptr || !(next->element_ < insert_node->element_))) [[likely]]
         {
-            auto next = node->level_[cur_level].next_;
-            while (next && next->element_ < insert_node->element_)
+            for (int l = 0; l <= top; l++)
             {
-                node = next;
-                next = node->level_[cur_level].next_;
+                cache_nodes[l] = finger_[l];
             }
-            cache_nodes[cur_level] = node;
-            cur_level--;
         }
+        else
+        {
+            search(insert_node->element_, top, cache_nodes);
+        }
+        return link(insert_node, node_level, cache_nodes);
+    }
 
-        // set index node linked list
-        for (int l = 0; l <= node_level; l++)
+    /// Append sorted elements, each one is linked in O(1) after the previous.
+    /// Elements out of order still go to the right place, only slower
+    void append_sorted(span<const E> elements)
+    {
+        for (size_t i = 0; i < elements.size(); i++)
         {
-            insert_node->level_[l].next_ = cache_nodes[l]->level_[l].next_;
-            cache_nodes[l]->level_[l].next_ = insert_node;
+            insert_hint(end(), elements.get()[i]);
         }
-        insert_node->back_ = node;
+    }
 
-        count_++;
-        level_ = level;
-        return iterator(insert_node);
+    /// Replace all elements by sorted elements, linking every tower in one pass
+    void build_sorted(span<const E> elements)
+    {
+        clear();
+        node_t *tails[MAXLEVEL];
+        for (int l = 0; l < MAXLEVEL; l++)
+        {
+            tails[l] = node_;
+        }
+        for (size_t i = 0; i < elements.size(); i++)
+        {
+            const E &element = elements.get()[i];
+            CXXASSERT_MSG(i == 0 || !(element < elements.get()[i - 1]), "elements are not sorted");
+            append(tails, element);
+        }
     }
 
     bool remove(const E &element)
     {
-        int cur_level = level_;
-        auto node = node_;
         node_t *cache_nodes[MAXLEVEL];
-        // for each level of node
-        // find the element path
-        while (cur_level >= 0)
+        auto node = search(element, level_, cache_nodes);
+        for (int l = 0; l <= level_; l++)
         {
-            auto next = node->level_[cur_level].next_;
-            while (next && next->element_ < element)
-            {
-                node = next;
-                next = node->level_[cur_level].next_;
-            }
-            cache_nodes[cur_level] = node;
-            cur_level--;
+            finger_[l] = cache_nodes[l];
         }
         auto next = node->level_[0].next_;
         if (next == nullptr || next->element_ != element)
@@ -158,10 +172,15 @@ template <typename E, typename RDENG = mt19937_random_engine, int MAXLEVEL = 20>
         for (int l = level_; l >= 0; l--)
         {
             auto cur = cache_nodes[l]->level_[l].next_;
-            if (cur != nullptr) {
+            if (cur == next)
+            {
                 cache_nodes[l]->level_[l].next_ = cur->level_[l].next_;
             }
         }
+        if (next->level_[0].next_ != nullptr)
+        {
+            next->level_[0].next_->back_ = node;
+        }
         next->element_.~E();
         allocator_->Delete(next);
 
@@ -216,7 +235,9 @@ template <typename E, typename RDENG = mt19937_random_engine, int MAXLEVEL = 20>
         return iterator(nullptr);
     }
 
-    iterator lower_find(const E &element) const
+    iterator lower_find(const E &element) const { return iterator(lower_node(element)); }
+
+    iterator upper_find(const E &element) const
     {
         node_t *node = node_;
         int cur_level = level_;
@@ -224,47 +245,82 @@ template <typename E, typename RDENG = mt19937_random_engine, int MAXLEVEL = 20>
         while (cur_level >= 0)
         {
             auto next = node->level_[cur_level].next_;
-            while (next && next->element_ < element)
+            while (next && next->element_ <= element)
             {
                 node = next;
                 next = node->level_[cur_level].next_;
             }
             cur_level--;
         }
-        if (node->element_ == element)
+        if (node != nullptr)
         {
-            return iterator(node);
+            return iterator(node->level_[0].next_);
         }
-        else
+        return end();
+    }
+
+    bool has(const E &element) const { return find(element) != end(); }
+
+    /// Visit the elements in [lo, hi) in order
+    void for_each_range(const E &lo, const E &hi, function_ref<void(const E &)> fn) const
+    {
+        for (node_t *node = lower_node(lo); node != nullptr && node->element_ < hi; node = node->level_[0].next_)
         {
-            return iterator(node->level_[0].next_);
+            fn(node->element_);
         }
     }
 
-    iterator upper_find(const E &element) const
+    /// \return The count of elements in [lo, hi), O(log n + count)
+    size_t count_range(const E &lo, const E &hi) const
     {
-        node_t *node = node_;
-        int cur_level = level_;
+        size_t count = 0;
+        for (node_t *node = lower_node(lo); node != nullptr && node->element_ < hi; node = node->level_[0].next_)
+        {
+            count++;
+        }
+        return count;
+    }
 
-        while (cur_level >= 0)
+    /// Remove the elements in [lo, hi).
+    /// Each level is relinked once past the run, then the run is freed along level 0
+    ///
+    /// \return The count of elements removed
+    size_t erase_range(const E &lo, const E &hi)
+    {
+        node_t *cache_nodes[MAXLEVEL];
+        search(lo, level_, cache_nodes);
+        for (int l = 0; l <= level_; l++)
         {
-            auto next = node->level_[cur_level].next_;
-            while (next && next->element_ <= element)
+            finger_[l] = cache_nodes[l];
+        }
+        for (int l = level_; l > 0; l--)
+        {
+            auto next = cache_nodes[l]->level_[l].next_;
+            while (next && next->element_ < hi)
             {
-                node = next;
-                next = node->level_[cur_level].next_;
+                next = next->level_[l].next_;
             }
-            cur_level--;
+            cache_nodes[l]->level_[l].next_ = next;
+        }
+        size_t removed = 0;
+        auto node = cache_nodes[0]->level_[0].next_;
+        while (node && node->element_ < hi)
+        {
+            auto next = node->level_[0].next_;
+            node->element_.~E();
+            allocator_->Delete(node);
+            node = next;
+            removed++;
         }
+        cache_nodes[0]->level_[0].next_ = node;
         if (node != nullptr)
         {
-            return iterator(node->level_[0].next_);
+            node->back_ = cache_nodes[0];
         }
-        return end();
+        count_ -= removed;
+        return removed;
     }
 
-    bool has(const E &element) const { return find(element) != end(); }
-
     void clear() noexcept
     {
         node_t *node = node_;
@@ -272,6 +328,7 @@ template <typename E, typename RDENG = mt19937_random_engine, int MAXLEVEL = 20>
         for (int i = MAXLEVEL - 1; i >= 0; i--)
         {
             node_->level_[i].next_ = nullptr;
+            finger_[i] = node_;
         }
         while (c != nullptr)
         {
@@ -281,6 +338,7 @@ template <typename E, typename RDENG = mt19937_random_engine, int MAXLEVEL = 20>
             c = next;
         }
         count_ = 0;
+        level_ = 0;
     }
 
   private:
@@ -288,17 +346,93 @@ template <typename E, typename RDENG = mt19937_random_engine, int MAXLEVEL = 20>
     int level_;
 
     node_t *node_;
+    // search path of the last insert or remove, the start of the next search
+    node_t *finger_[MAXLEVEL];
     RDENG engine_;
     Allocator *allocator_;
 
-    int rand()
+    int rand() { return geometric_level<MAXLEVEL, PROMOTE_BITS>(engine_()); }
+
+    // first node not less than element
+    node_t *lower_node(const E &element) const
+    {
+        node_t *node = node_;
+        for (int cur_level = level_; cur_level >= 0; cur_level--)
+        {
+            auto next = node->level_[cur_level].next_;
+            while (next && next->element_ < element)
+            {
+                node = next;
+                next = node->level_[cur_level].next_;
+            }
+        }
+        return node->level_[0].next_;
+    }
+
+    /// Walk to the last node less than element on every level up to top.
+    /// The walk starts from the finger when element is after it, climbing only until
+    /// the next node is not less than element, so nearby keys cost O(log distance)
+    node_t *search(const E &element, int top, node_t **cache_nodes)
+    {
+        int cur_level = top;
+        node_t *node = node_;
+        if (finger_[0] == node_ || finger_[0]->element_ < element)
+        {
+            cur_level = 0;
+            while (cur_level < top)
+            {
+                auto next = finger_[cur_level]->level_[cur_level].next_;
+                if (next == nullptr || !(next->element_ < element))
+                {
+                    break;
+                }
+                cur_level++;
+            }
+            for (int l = top; l > cur_level; l--)
+            {
+                cache_nodes[l] = finger_[l];
+            }
+            node = finger_[cur_level];
+        }
+        // for each level of node
+        // find the element path
+        while (cur_level >= 0)
+        {
+            auto next = node->level_[cur_level].next_;
+            while (next && next->element_ < element)
+            {
+                node = next;
+                next = node->level_[cur_level].next_;
+            }
+            cache_nodes[cur_level] = node;
+            cur_level--;
+        }
+        return node;
+    }
+
+    iterator link(node_t *insert_node, int node_level, node_t **cache_nodes)
     {
-        int node_level = 1;
-        random_generator rng(engine_);
+        int level = node_level > level_ ? node_level : level_;
+        // set index node linked list
+        for (int l = 0; l <= node_level; l++)
+        {
+            insert_node->level_[l].next_ = cache_nodes[l]->level_[l].next_;
+            cache_nodes[l]->level_[l].next_ = insert_node;
+            finger_[l] = insert_node;
+        }
+        for (int l = node_level + 1; l <= level; l++)
+        {
+            finger_[l] = cache_nodes[l];
+        }
+        insert_node->back_ = cache_nodes[0];
+        if (insert_node->level_[0].next_ != nullptr)
+        {
+            insert_node->level_[0].next_->back_ = insert_node;
+        }
 
-        while (rng.gen_range(0, 2) == 0 && node_level < MAXLEVEL)
-            node_level++;
-        return node_level - 1;
+        count_++;
+        level_ = level;
+        return iterator(insert_node);
     }
 
     void free() noexcept
@@ -313,25 +447,53 @@ template <typename E, typename RDENG = mt19937_random_engine, int MAXLEVEL = 20>
         }
     }
 
-    void init() { node_ = make_empty_node(MAXLEVEL); }
+    void init()
+    {
+        node_ = make_empty_node(MAXLEVEL);
+        for (int i = 0; i < MAXLEVEL; i++)
+        {
+            finger_[i] = node_;
+        }
+    }
 
     void copy(const skip_list &rhs)
     {
         count_ = 0;
-        level_ = 1;
+        level_ = 0;
         allocator_ = rhs.allocator_;
         init();
-        // TODO: n*log(n)
-        auto iter = rhs.begin();
-        auto end = rhs.end();
-        while (iter != end)
+        node_t *tails[MAXLEVEL];
+        for (int l = 0; l < MAXLEVEL; l++)
+        {
+            tails[l] = node_;
+        }
+        for (const node_t *node = rhs.node_->level_[0].next_; node != nullptr; node = node->level_[0].next_)
         {
-            E v = *iter;
-            insert(std::move(v));
-            iter++;
+            append(tails, node->element_);
         }
     }
 
+    /// Link a new node after the last node of each level
+    /// The tails stay the search path of the list end, so they are the finger too
+    template <typename... Args> void append(node_t **tails, Args &&...args)
+    {
+        int node_level = this->rand();
+        auto node = make_node(node_level + 1, std::forward<Args>(args)...);
+        node->back_ = tails[0];
+        for (int l = 0; l <= node_level; l++)
+        {
+            node->level_[l].next_ = nullptr;
+            tails[l]->level_[l].next_ = node;
+            tails[l] = node;
+            finger_[l] = node;
+        }
+        if (node_level > level_)
+        {
+            level_ = node_level;
+        }
+        count_++;
+    }
+
     void move(skip_list &&rhs) noexcept
     {
         count_ = rhs.count_;
@@ -339,6 +501,11 @@ template <typename E, typename RDENG = mt19937_random_engine, int MAXLEVEL = 20>
         node_ = rhs.node_;
         allocator_ = rhs.allocator_;
 
+        for (int i = 0; i < MAXLEVEL; i++)
+        {
+            finger_[i] = rhs.finger_[i];
+        }
+
         rhs.count_ = 0;
         rhs.level_ = 0;
         rhs.node_ = nullptr;
@@ -0,0 +1,522 @@
+#pragma once
+#include "freelibcxx/allocator.hpp"
+#include "freelibcxx/assert.hpp"
+#include "freelibcxx/iterator.hpp"
+#include "freelibcxx/optional.hpp"
+#include "freelibcxx/random.hpp"
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+namespace freelibcxx
+{
+
+template <typename K, typename V> struct skip_map_pair
+{
+    K key;
+    V value;
+    template <typename... Args>
+    skip_map_pair(K key, Args &&...args)
+        : key(std::move(key))
+        , value(std::forward<Args>(args)...)
+    {
+    }
+};
+
+/// An ordered map on a skip list.
+/// Every index link stores its span, the count of bottom level steps it jumps,
+/// so positions are found on the way down: rank, select and count_range are O(log n).
+template <typename K, typename V, typename Compare = std::less<K>, typename RDENG = xorshift_random_engine,
+          int MAXLEVEL = 20, int PROMOTE_BITS = 1>
+class skip_map
+{
+    static_assert(PROMOTE_BITS > 0 && PROMOTE_BITS <= 4);
+
+  public:
+    using pair_t = skip_map_pair<K, V>;
+    struct node_t;
+
+  private:
+    template <typename N, typename P> struct value_fn
+    {
+        P operator()(N val) { return &val->pair_; }
+    };
+    template <typename N> struct prev_fn
+    {
+        N operator()(N val) { return val->back_; }
+    };
+    template <typename N> struct next_fn
+    {
+        N operator()(N val) { return val->level_[0].next_; }
+    };
+
+    using NE = node_t *;
+    using CE = const node_t *;
+
+  public:
+    using const_iterator = base_bidirectional_iterator<CE, value_fn<CE, const pair_t *>, prev_fn<CE>, next_fn<CE>>;
+    using iterator = base_bidirectional_iterator<NE, value_fn<NE, pair_t *>, prev_fn<NE>, next_fn<NE>>;
+
+    skip_map(Allocator *allocator, uint64_t seed = 0, Compare compare = Compare())
+        : count_(0)
+        , level_(0)
+        , engine_(seed)
+        , compare_(std::move(compare))
+        , allocator_(allocator)
+    {
+        init();
+    }
+
+    skip_map(const skip_map &rhs)
+        : engine_(rhs.engine_.pick())
+        , compare_(rhs.compare_)
+    {
+        copy(rhs);
+    }
+
+    skip_map(skip_map &&rhs) noexcept
+        : engine_(rhs.engine_.pick())
+        , compare_(rhs.compare_)
+    {
+        move(std::move(rhs));
+    }
+
+    ~skip_map() { free(); }
+
+    skip_map &operator=(const skip_map &rhs)
+    {
+        if (this == &rhs)
+            return *this;
+        free();
+        compare_ = rhs.compare_;
+        copy(rhs);
+        return *this;
+    }
+
+    skip_map &operator=(skip_map &&rhs) noexcept
+    {
+        if (this == &rhs)
+            return *this;
+        free();
+        compare_ = rhs.compare_;
+        move(std::move(rhs));
+        return *this;
+    }
+
+    /// Insert a new element only if key is absent
+    ///
+    /// \return The element with key, and whether it was inserted
+    template <typename... Args> std::pair<iterator, bool> insert(const K &key, Args &&...args)
+    {
+        node_t *path[MAXLEVEL];
+        size_t ranks[MAXLEVEL];
+        node_t *prev = search(key, path, ranks);
+        node_t *next = prev->level_[0].next_;
+        if (next != nullptr && !compare_(key, next->pair_.key))
+        {
+            return std::make_pair(iterator(next), false);
+        }
+        return std::make_pair(iterator(link(path, ranks, key, std::forward<Args>(args)...)), true);
+    }
+
+    /// Insert key with value, or assign value to the existing element
+    ///
+    /// \return The element with key, and whether it was inserted
+    template <typename M> std::pair<iterator, bool> insert_or_assign(const K &key, M &&value)
+    {
+        auto [it, inserted] = insert(key, std::forward<M>(value));
+        if (!inserted)
+        {
+            it->value = std::forward<M>(value);
+        }
+        return std::make_pair(it, inserted);
+    }
+
+    bool remove(const K &key)
+    {
+        node_t *path[MAXLEVEL];
+        size_t ranks[MAXLEVEL];
+        node_t *node = search(key, path, ranks)->level_[0].next_;
+        if (node == nullptr || compare_(key, node->pair_.key))
+        {
+            return false;
+        }
+        unlink(node, path);
+        return true;
+    }
+
+    iterator remove(iterator iter)
+    {
+        node_t *path[MAXLEVEL];
+        size_t ranks[MAXLEVEL];
+        node_t *node = iter.get();
+        node_t *next = node->level_[0].next_;
+        search(node->pair_.key, path, ranks);
+        unlink(node, path);
+        return iterator(next);
+    }
+
+    optional<V> get(const K &key) const
+    {
+        const V *v = get_ptr(key);
+        if (v == nullptr)
+        {
+            return nullopt;
+        }
+        return *v;
+    }
+
+    V *get_ptr(const K &key)
+    {
+        node_t *node = find_node(key);
+        return node == nullptr ? nullptr : &node->pair_.value;
+    }
+
+    const V *get_ptr(const K &key) const
+    {
+        node_t *node = find_node(key);
+        return node == nullptr ? nullptr : &node->pair_.value;
+    }
+
+    iterator find(const K &key) { return iterator(find_node(key)); }
+
+    const_iterator find(const K &key) const { return const_iterator(find_node(key)); }
+
+    bool has(const K &key) const { return find_node(key) != nullptr; }
+
+    /// \return The first element whose key is not less than key
+    iterator lower_find(const K &key) { return iterator(lower_node(key)); }
+
+    const_iterator lower_find(const K &key) const { return const_iterator(lower_node(key)); }
+
+    /// \return The first element whose key is greater than key
+    iterator upper_find(const K &key) { return iterator(upper_node(key)); }
+
+    const_iterator upper_find(const K &key) const { return const_iterator(upper_node(key)); }
+
+    /// \return The count of keys less than key, which is the index key has or would have
+    size_t rank(const K &key) const
+    {
+        node_t *path[MAXLEVEL];
+        size_t ranks[MAXLEVEL];
+        search(key, path, ranks);
+        return ranks[0];
+    }
+
+    /// \return The element at index, or end() if index is out of range
+    iterator select(size_t index) { return iterator(select_node(index)); }
+
+    const_iterator select(size_t index) const { return const_iterator(select_node(index)); }
+
+    pair_t &at(size_t index)
+    {
+        CXXASSERT(index < count_);
+        return select_node(index)->pair_;
+    }
+
+    const pair_t &at(size_t index) const
+    {
+        CXXASSERT(index < count_);
+        return select_node(index)->pair_;
+    }
+
+    /// \return The count of keys in [lo, hi)
+    size_t count_range(const K &lo, const K &hi) const
+    {
+        if (!compare_(lo, hi))
+        {
+            return 0;
+        }
+        return rank(hi) - rank(lo);
+    }
+
+    size_t size() const { return count_; }
+
+    bool empty() const { return count_ == 0; }
+
+    iterator begin() { return iterator(node_->level_[0].next_); }
+
+    iterator end() { return iterator(nullptr); }
+
+    const_iterator begin() const { return const_iterator(node_->level_[0].next_); }
+
+    const_iterator end() const { return const_iterator(nullptr); }
+
+    void clear() noexcept
+    {
+        node_t *c = node_->level_[0].next_;
+        while (c != nullptr)
+        {
+            auto next = c->level_[0].next_;
+            destroy(c);
+            c = next;
+        }
+        for (int i = 0; i < MAXLEVEL; i++)
+        {
+            node_->level_[i].next_ = nullptr;
+            node_->level_[i].span_ = 0;
+        }
+        count_ = 0;
+        level_ = 0;
+    }
+
+  private:
+    size_t count_;
+    int level_;
+
+    node_t *node_;
+    RDENG engine_;
+    Compare compare_;
+    Allocator *allocator_;
+
+    int rand() { return geometric_level<MAXLEVEL, PROMOTE_BITS>(engine_()); }
+
+    /// Walk down to the last node whose key is less than key on every level
+    ///
+    /// \param ranks the index + 1 of each path node, 0 for the head
+    /// \return path[0]
+    node_t *search(const K &key, node_t **path, size_t *ranks) const
+    {
+        node_t *node = node_;
+        size_t rank = 0;
+        for (int l = level_; l >= 0; l--)
+        {
+            auto next = node->level_[l].next_;
+            while (next && compare_(next->pair_.key, key))
+            {
+                rank += node->level_[l].span_;
+                node = next;
+                next = node->level_[l].next_;
+            }
+            path[l] = node;
+            ranks[l] = rank;
+        }
+        return node;
+    }
+
+    node_t *lower_node(const K &key) const
+    {
+        node_t *node = node_;
+        for (int l = level_; l >= 0; l--)
+        {
+            auto next = node->level_[l].next_;
+            while (next && compare_(next->pair_.key, key))
+            {
+                node = next;
+                next = node->level_[l].next_;
+            }
+        }
+        return node->level_[0].next_;
+    }
+
+    node_t *upper_node(const K &key) const
+    {
+        node_t *node = node_;
+        for (int l = level_; l >= 0; l--)
+        {
+            auto next = node->level_[l].next_;
+            while (next && !compare_(key, next->pair_.key))
+            {
+                node = next;
+                next = node->level_[l].next_;
+            }
+        }
+        return node->level_[0].next_;
+    }
+
+    node_t *find_node(const K &key) const
+    {
+        node_t *node = lower_node(key);
+        if (node != nullptr && !compare_(key, node->pair_.key))
+        {
+            return node;
+        }
+        return nullptr;
+    }
+
+    node_t *select_node(size_t index) const
+    {
+        if (index >= count_)
+        {
+            return nullptr;
+        }
+        node_t *node = node_;
+        size_t rank = 0;
+        for (int l = level_; l >= 0; l--)
+        {
+            auto next = node->level_[l].next_;
+            while (next && rank + node->level_[l].span_ <= index + 1)
+            {
+                rank += node->level_[l].span_;
+                node = next;
+                next = node->level_[l].next_;
+            }
+            if (rank == index + 1)
+            {
+                break;
+            }
+        }
+        return node;
+    }
+
+    /// Link a new node after path[0]
+    /// A link without next spans to the end of the list: count - rank
+    template <typename... Args> node_t *link(node_t **path, size_t *ranks, Args &&...args)
+    {
+        int node_level = rand();
+        if (node_level > level_)
+        {
+            for (int l = level_ + 1; l <= node_level; l++)
+            {
+                path[l] = node_;
+                ranks[l] = 0;
+                node_->level_[l].span_ = count_;
+            }
+            level_ = node_level;
+        }
+        node_t *node = make_node(node_level + 1, std::forward<Args>(args)...);
+        for (int l = 0; l <= node_level; l++)
+        {
+            index_node_t &index = path[l]->level_[l];
+            node->level_[l].next_ = index.next_;
+            node->level_[l].span_ = index.span_ - (ranks[0] - ranks[l]);
+            index.next_ = node;
+            index.span_ = ranks[0] - ranks[l] + 1;
+        }
+        for (int l = node_level + 1; l <= level_; l++)
+        {
+            path[l]->level_[l].span_++;
+        }
+        node->back_ = path[0] == node_ ? nullptr : path[0];
+        if (node->level_[0].next_ != nullptr)
+        {
+            node->level_[0].next_->back_ = node;
+        }
+        count_++;
+        return node;
+    }
+
+    void unlink(node_t *node, node_t **path)
+    {
+        for (int l = 0; l <= level_; l++)
+        {
+            index_node_t &index = path[l]->level_[l];
+            if (index.next_ == node)
+            {
+                index.span_ += node->level_[l].span_ - 1;
+                index.next_ = node->level_[l].next_;
+            }
+            else
+            {
+                index.span_--;
+            }
+        }
+        if (node->level_[0].next_ != nullptr)
+        {
+            node->level_[0].next_->back_ = node->back_;
+        }
+        destroy(node);
+        count_--;
+    }
+
+    void free() noexcept
+    {
+        if (node_ != nullptr)
+        {
+            clear();
+            allocator_->deallocate(node_);
+            node_ = nullptr;
+        }
+    }
+
+    void init() { node_ = make_empty_node(MAXLEVEL); }
+
+    void copy(const skip_map &rhs)
+    {
+        count_ = 0;
+        level_ = 0;
+        allocator_ = rhs.allocator_;
+        init();
+        // append in order, the path is always the tail of each level
+        node_t *path[MAXLEVEL];
+        size_t ranks[MAXLEVEL];
+        for (int l = 0; l < MAXLEVEL; l++)
+        {
+            path[l] = node_;
+            ranks[l] = 0;
+        }
+        for (CE node = rhs.node_->level_[0].next_; node != nullptr; node = node->level_[0].next_)
+        {
+            node_t *tail = link(path, ranks, node->pair_.key, node->pair_.value);
+            for (int l = 0; l <= level_; l++)
+            {
+                if (path[l]->level_[l].next_ == tail)
+                {
+                    path[l] = tail;
+                    ranks[l] = count_;
+                }
+            }
+        }
+    }
+
+    void move(skip_map &&rhs) noexcept
+    {
+        count_ = rhs.count_;
+        level_ = rhs.level_;
+        node_ = rhs.node_;
+        allocator_ = rhs.allocator_;
+
+        rhs.count_ = 0;
+        rhs.level_ = 0;
+        rhs.node_ = nullptr;
+    }
+
+    node_t *make_empty_node(int level)
+    {
+        void *n = allocator_->allocate(sizeof(node_t) + level * sizeof(index_node_t), alignof(node_t));
+        node_t *node = new (n) node_t();
+        for (int i = 0; i < level; i++)
+        {
+            node->level_[i].next_ = nullptr;
+            node->level_[i].span_ = 0;
+        }
+        return node;
+    }
+
+    template <typename... Args> node_t *make_node(int level, Args &&...args)
+    {
+        void *n = allocator_->allocate(sizeof(node_t) + level * sizeof(index_node_t), alignof(node_t));
+        node_t *node = new (n) node_t();
+        new (&node->pair_) pair_t(std::forward<Args>(args)...);
+        return node;
+    }
+
+    void destroy(node_t *node)
+    {
+        node->pair_.~pair_t();
+        allocator_->deallocate(node);
+    }
+
+  public:
+    struct index_node_t
+    {
+        node_t *next_;
+        size_t span_;
+    };
+    struct node_t
+    {
+        node_t *back_;
+        union
+        {
+            pair_t pair_;
+        };
+        index_node_t level_[0];
+        node_t()
+            : back_(nullptr)
+        {
+        }
+        ~node_t() {}
+    };
+};
+
+} // namespace freelibcxx
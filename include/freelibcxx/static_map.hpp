@@ -0,0 +1,213 @@
+#pragma once
+#include "freelibcxx/extern.hpp"
+#include "freelibcxx/hash.hpp"
+#include "freelibcxx/string.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace freelibcxx
+{
+namespace detail
+{
+constexpr size_t const_strlen(const char *str)
+{
+    size_t len = 0;
+    while (str[len] != 0)
+    {
+        len++;
+    }
+    return len;
+}
+
+constexpr bool const_streq(const char *a, size_t alen, const char *b, size_t blen)
+{
+    if (alen != blen)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < alen; i++)
+    {
+        if (a[i] != b[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// not constexpr, reaching it in constant evaluation is a compile error
+inline void static_map_duplicate_key() {}
+inline void string_switch_unknown_case() {}
+} // namespace detail
+
+/// Hash of a string for static_map and case labels, the same at compile time and runtime
+constexpr uint64_t static_hash(const char *str, size_t len) { return detail::wyhash(str, len, 0); }
+
+template <typename V> struct static_map_entry
+{
+    const char *key;
+    V value;
+};
+
+/// An immutable string keyed map built at compile time.
+/// Entries are sorted by hash, a lookup hashes the key once, binary searches
+/// the hashes and confirms with one memcmp.
+///
+/// constexpr auto map = make_static_map<int>({{"get", 1}, {"put", 2}});
+template <typename V, size_t N> class static_map
+{
+  public:
+    consteval static_map(const static_map_entry<V> (&entries)[N])
+        : hashes_()
+        , keys_()
+        , lens_()
+        , values_()
+    {
+        for (size_t i = 0; i < N; i++)
+        {
+            keys_[i] = entries[i].key;
+            lens_[i] = detail::const_strlen(entries[i].key);
+            hashes_[i] = static_hash(keys_[i], lens_[i]);
+            values_[i] = entries[i].value;
+        }
+        // insertion sort by hash
+        for (size_t i = 1; i < N; i++)
+        {
+            for (size_t j = i; j > 0 && hashes_[j] < hashes_[j - 1]; j--)
+            {
+                swap_at(j, j - 1);
+            }
+        }
+        for (size_t i = 1; i < N; i++)
+        {
+            for (size_t j = i; j > 0 && hashes_[j - 1] == hashes_[i]; j--)
+            {
+                if (detail::const_streq(keys_[i], lens_[i], keys_[j - 1], lens_[j - 1]))
+                {
+                    detail::static_map_duplicate_key();
+                }
+            }
+        }
+    }
+
+    const V *get(const char *key, size_t len) const
+    {
+        uint64_t hash = static_hash(key, len);
+        size_t beg = 0;
+        size_t end = N;
+        while (beg != end)
+        {
+            size_t m = beg + (end - beg) / 2;
+            if (hashes_[m] < hash)
+            {
+                beg = m + 1;
+            }
+            else
+            {
+                end = m;
+            }
+        }
+        for (; beg < N && hashes_[beg] == hash; beg++)
+        {
+            if (lens_[beg] == len && memcmp(keys_[beg], key, len) == 0)
+            {
+                return &values_[beg];
+            }
+        }
+        return nullptr;
+    }
+
+    const V *get(const_string_view key) const { return get(key.data(), key.size()); }
+
+    bool has(const_string_view key) const { return get(key) != nullptr; }
+
+    constexpr size_t size() const { return N; }
+
+  private:
+    uint64_t hashes_[N];
+    const char *keys_[N];
+    size_t lens_[N];
+    V values_[N];
+
+    constexpr void swap_at(size_t i, size_t j)
+    {
+        uint64_t h = hashes_[i];
+        hashes_[i] = hashes_[j];
+        hashes_[j] = h;
+        const char *k = keys_[i];
+        keys_[i] = keys_[j];
+        keys_[j] = k;
+        size_t l = lens_[i];
+        lens_[i] = lens_[j];
+        lens_[j] = l;
+        V v = values_[i];
+        values_[i] = values_[j];
+        values_[j] = v;
+    }
+};
+
+template <typename V, size_t N> consteval static_map<V, N> make_static_map(const static_map_entry<V> (&entries)[N])
+{
+    return static_map<V, N>(entries);
+}
+
+/// Map a string to the index of a case, or -1.
+///
+/// static constexpr string_switch commands({"open", "close"});
+/// switch (commands(name)) { case commands.index_of("open"): ... }
+template <size_t N> class string_switch
+{
+  public:
+    consteval string_switch(const char *const (&cases)[N])
+        : cases_()
+        , map_(make_entries(cases).entries)
+    {
+        for (size_t i = 0; i < N; i++)
+        {
+            cases_[i] = cases[i];
+        }
+    }
+
+    int operator()(const_string_view str) const
+    {
+        const int *index = map_.get(str);
+        return index != nullptr ? *index : -1;
+    }
+
+    /// \return index of the case at compile time, a name which is not a case does not compile
+    consteval int index_of(const char *str) const
+    {
+        for (size_t i = 0; i < N; i++)
+        {
+            if (detail::const_streq(cases_[i], detail::const_strlen(cases_[i]), str, detail::const_strlen(str)))
+            {
+                return i;
+            }
+        }
+        detail::string_switch_unknown_case();
+        return -1;
+    }
+
+  private:
+    struct entries_t
+    {
+        static_map_entry<int> entries[N];
+    };
+
+    static constexpr entries_t make_entries(const char *const (&cases)[N])
+    {
+        entries_t e = {};
+        for (size_t i = 0; i < N; i++)
+        {
+            e.entries[i] = {cases[i], (int)i};
+        }
+        return e;
+    }
+
+    const char *cases_[N];
+    static_map<int, N> map_;
+};
+
+template <size_t N> string_switch(const char *const (&)[N]) -> string_switch<N>;
+
+} // namespace freelibcxx
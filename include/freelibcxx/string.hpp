@@ -1272,17 +1272,17 @@ inline string &operator<<(string &s, int64_t val)
 
 template <> struct hasher<string>
 {
-    size_t operator()(const string &t) { return detail::murmur_hash2_64(t.data(), t.size(), 0); }
+    size_t operator()(const string &t) { return detail::wyhash(t.data(), t.size(), 0); }
 };
 
 template <> struct hasher<string_view>
 {
-    size_t operator()(const string &t) { return detail::murmur_hash2_64(t.data(), t.size(), 0); }
+    size_t operator()(string_view t) { return detail::wyhash(t.data(), t.size(), 0); }
 };
 
 template <> struct hasher<const_string_view>
 {
-    size_t operator()(const string &t) { return detail::murmur_hash2_64(t.data(), t.size(), 0); }
+    size_t operator()(const_string_view t) { return detail::wyhash(t.data(), t.size(), 0); }
 };
 
 } // namespace freelibcxx
@@ -42,4 +42,15 @@ static constexpr inline char toupper(char c)
     return c;
 }
 
-} // namespace freelibcxx
\ No newline at end of file
+namespace detail
+{
+/// Hint to the cpu in a spin wait loop
+inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+} // namespace detail
+
+} // namespace freelibcxx
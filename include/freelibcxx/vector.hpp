@@ -146,7 +146,7 @@ template <typename E> class base_vector
     {
         CXXASSERT(index <= count_);
         ensure(count_ + 1);
-        if (count_ > 0) [[likely]]
+        if (index < count_)
         {
             if constexpr (std::is_nothrow_move_constructible_v<E>)
             {
@@ -167,9 +167,6 @@ template <typename E> class base_vector
                     buffer_[i] = buffer_[i - 1];
                 }
             }
-        }
-        if (index < count_)
-        {
             buffer_[index].~E();
         }
 
@@ -308,6 +305,8 @@ template <typename E> class base_vector
 
     const E *data() const { return buffer_; }
 
+    Allocator *allocator() const { return allocator_; }
+
     void ensure(size_t new_cap)
     {
         if (new_cap > cap_)
@@ -0,0 +1,149 @@
+#include "freelibcxx/btree.hpp"
+#include "catch2/internal/catch_run_context.hpp"
+#include "common.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace freelibcxx;
+
+TEST_CASE("insert btree map", "btree")
+{
+    btree_map<int, Int> map(&LibAllocatorV);
+    REQUIRE(map.empty());
+    REQUIRE(map.find(1) == map.end());
+    REQUIRE(map.insert(1, 10).second);
+    REQUIRE(!map.insert(1, 11).second);
+    REQUIRE(map.get(1).value().v == 10);
+    REQUIRE(!map.insert_or_assign(1, 12).second);
+    REQUIRE(map.get_ptr(1)->v == 12);
+    REQUIRE(map.get_ptr(2) == nullptr);
+
+    for (int i = 1000; i > 1; i--)
+    {
+        REQUIRE(map.insert(i, i * 10).second);
+    }
+    REQUIRE(map.size() == 1000);
+    REQUIRE(map.height() >= 1);
+    int expect = 1;
+    for (auto it = map.begin(); it != map.end(); ++it)
+    {
+        REQUIRE(it.key() == expect);
+        expect++;
+    }
+    REQUIRE(expect == 1001);
+    REQUIRE(map.lower_find(0).key() == 1);
+    REQUIRE(map.upper_find(500).key() == 501);
+    REQUIRE(map.upper_find(1000) == map.end());
+    auto it = map.find(300);
+    --it;
+    REQUIRE(it.key() == 299);
+    REQUIRE(it.value().v == 2990);
+}
+
+TEST_CASE("remove btree map", "btree")
+{
+    btree_map<int, Int, std::less<int>, 128> map(&LibAllocatorV);
+    for (int i = 0; i < 2000; i++)
+    {
+        map.insert(i, i);
+    }
+    for (int i = 0; i < 2000; i += 2)
+    {
+        REQUIRE(map.remove(i));
+    }
+    REQUIRE(!map.remove(0));
+    REQUIRE(map.size() == 1000);
+    for (int i = 0; i < 2000; i++)
+    {
+        REQUIRE(map.has(i) == (i % 2 == 1));
+    }
+    auto it = map.remove(map.find(1));
+    REQUIRE(it.key() == 3);
+    for (int i = 3; i < 2000; i += 2)
+    {
+        REQUIRE(map.remove(i));
+    }
+    REQUIRE(map.empty());
+    REQUIRE(map.begin() == map.end());
+    map.insert(5, 5);
+    REQUIRE(map.begin().key() == 5);
+}
+
+TEST_CASE("random btree", "btree")
+{
+    btree_set<int, std::less<int>, 64> set(&LibAllocatorV);
+    std::set<int> expect;
+    std::mt19937 rng(Catch::rngSeed());
+    for (int i = 0; i < 50000; i++)
+    {
+        int k = rng() % 3000;
+        if (rng() % 2 == 0)
+        {
+            REQUIRE(set.remove(k) == (expect.erase(k) == 1));
+        }
+        else
+        {
+            REQUIRE(set.insert(k).second == expect.insert(k).second);
+        }
+        if (i % 1000 == 0)
+        {
+            REQUIRE(set.size() == expect.size());
+            auto it = set.begin();
+            for (int v : expect)
+            {
+                REQUIRE(*it == v);
+                ++it;
+            }
+            REQUIRE(it == set.end());
+        }
+    }
+    btree_set<int, std::less<int>, 64> copy = set;
+    REQUIRE(copy.size() == expect.size());
+    for (int k = 0; k < 3000; k++)
+    {
+        REQUIRE(copy.has(k) == (expect.count(k) == 1));
+        REQUIRE((copy.lower_find(k) == copy.end()) == (expect.lower_bound(k) == expect.end()));
+    }
+    btree_set<int, std::less<int>, 64> moved = std::move(copy);
+    REQUIRE(copy.empty());
+    REQUIRE(moved.size() == expect.size());
+}
+
+TEST_CASE("build btree", "btree")
+{
+    for (size_t n : {0, 1, 7, 100, 10000})
+    {
+        std::vector<long> keys;
+        std::vector<long> values;
+        for (size_t i = 0; i < n; i++)
+        {
+            keys.push_back(i * 3);
+            values.push_back(i);
+        }
+        btree_map<long, long> map(&LibAllocatorV);
+        map.insert(-1, 0);
+        map.build_sorted(span<const long>(keys.data(), n), span<const long>(values.data(), n));
+        REQUIRE(map.size() == n);
+        size_t i = 0;
+        for (auto it = map.begin(); it != map.end(); ++it, i++)
+        {
+            REQUIRE(it.key() == (long)i * 3);
+            REQUIRE(it.value() == (long)i);
+        }
+        REQUIRE(i == n);
+        // the built tree stays balanced under updates
+        for (size_t i = 0; i < n; i += 2)
+        {
+            REQUIRE(map.remove(i * 3));
+            REQUIRE(map.insert(i * 3 + 1, 0).second);
+        }
+        for (size_t i = 0; i < n; i++)
+        {
+            REQUIRE(map.has(i * 3) == (i % 2 == 1));
+            REQUIRE(map.has(i * 3 + 1) == (i % 2 == 0));
+        }
+    }
+}
@@ -0,0 +1,171 @@
+#include "freelibcxx/cache.hpp"
+#include "catch2/internal/catch_run_context.hpp"
+#include "common.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace freelibcxx;
+
+TEST_CASE("lru cache", "cache")
+{
+    std::vector<int> evicted;
+    auto on_evict = [&](const int &key, Int &value) {
+        REQUIRE(value.v == key * 10);
+        evicted.push_back(key);
+    };
+    lru_cache<int, Int> cache(&LibAllocatorV, 3, lru_cache<int, Int>::evict_callback::borrow(on_evict));
+    cache.put(1, 10);
+    cache.put(2, 20);
+    cache.put(3, 30);
+    REQUIRE(cache.size() == 3);
+    REQUIRE(cache.get(1)->v == 10);
+    // 2 is the least recently used now
+    cache.put(4, 40);
+    REQUIRE(evicted == std::vector<int>{2});
+    REQUIRE(!cache.has(2));
+    REQUIRE(cache.peek(3)->v == 30);
+    cache.put(5, 50);
+    REQUIRE(evicted == std::vector<int>{2, 3});
+
+    cache.put(1, 10);
+    std::vector<int> order;
+    cache.for_each([&](const int &key, Int &) { order.push_back(key); });
+    REQUIRE(order == std::vector<int>{1, 5, 4});
+
+    REQUIRE(cache.remove(5));
+    REQUIRE(!cache.remove(5));
+    REQUIRE(cache.size() == 2);
+    cache.put(6, 60);
+    REQUIRE(evicted.size() == 2);
+}
+
+TEST_CASE("get or load cache", "cache")
+{
+    int loads = 0;
+    auto loader = [&](const int &key) -> optional<int> {
+        loads++;
+        if (key < 0)
+        {
+            return nullopt;
+        }
+        return key * 2;
+    };
+    lru_cache<int, int> lru(&LibAllocatorV, 10);
+    REQUIRE(*lru.get_or_load(4, loader) == 8);
+    REQUIRE(*lru.get_or_load(4, loader) == 8);
+    REQUIRE(lru.get_or_load(-1, loader) == nullptr);
+    REQUIRE(loads == 2);
+    REQUIRE(lru.size() == 1);
+
+    clock_cache<int, int> clock(&LibAllocatorV, 10);
+    REQUIRE(*clock.get_or_load(4, loader) == 8);
+    REQUIRE(*clock.get_or_load(4, loader) == 8);
+    REQUIRE(clock.get_or_load(-1, loader) == nullptr);
+    REQUIRE(loads == 4);
+    REQUIRE(clock.size() == 1);
+}
+
+TEST_CASE("clock cache", "cache")
+{
+    std::vector<int> evicted;
+    auto on_evict = [&](const int &key, Int &) { evicted.push_back(key); };
+    clock_cache<int, Int> cache(&LibAllocatorV, 4, clock_cache<int, Int>::evict_callback::borrow(on_evict));
+    for (int i = 0; i < 4; i++)
+    {
+        cache.put(i, i);
+    }
+    REQUIRE(cache.get(0)->v == 0);
+    REQUIRE(cache.get(1) != nullptr);
+    // 0 and 1 get a second chance
+    cache.put(4, 4);
+    REQUIRE(evicted == std::vector<int>{2});
+    REQUIRE(cache.has(0));
+    REQUIRE(cache.has(1));
+    REQUIRE(cache.remove(3));
+    cache.put(5, 5);
+    REQUIRE(evicted.size() == 1);
+    REQUIRE(cache.size() == 4);
+    cache.clear();
+    REQUIRE(cache.size() == 0);
+    REQUIRE(!cache.has(0));
+}
+
+TEST_CASE("random cache", "cache")
+{
+    lru_cache<int, Int> lru(&LibAllocatorV, 64);
+    clock_cache<int, Int> clock(&LibAllocatorV, 64);
+    std::mt19937 rng(Catch::rngSeed());
+    for (int i = 0; i < 20000; i++)
+    {
+        int k = rng() % 256;
+        if (rng() % 4 == 0)
+        {
+            lru.remove(k);
+            clock.remove(k);
+        }
+        else
+        {
+            lru.put(k, k);
+            clock.put(k, k);
+        }
+        REQUIRE(lru.size() <= 64);
+        REQUIRE(clock.size() <= 64);
+        Int *v = lru.get(k);
+        REQUIRE((v == nullptr || v->v == k));
+        v = clock.get(k);
+        REQUIRE((v == nullptr || v->v == k));
+    }
+}
+
+TEST_CASE("sharded cache", "cache")
+{
+    sharded_cache<lru_cache<long, long>> cache(&LibAllocatorV, 1024);
+    std::vector<std::thread> threads;
+    std::atomic<int> bad = 0;
+    for (int t = 0; t < 4; t++)
+    {
+        threads.emplace_back([&, t]() {
+            for (long i = 0; i < 20000; i++)
+            {
+                long k = (i * 7 + t) % 2000;
+                auto v = cache.get_or_load(k, [](const long &key) -> optional<long> { return key * 3; });
+                if (v.value() != k * 3)
+                {
+                    bad++;
+                }
+                if (i % 5 == 0)
+                {
+                    cache.remove(k);
+                }
+            }
+        });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    REQUIRE(bad == 0);
+    REQUIRE(cache.size() <= 1024);
+    cache.put(1, 3);
+    REQUIRE(cache.get(1).value() == 3);
+}
+
+TEST_CASE("evict into argument cache", "cache")
+{
+    // the new value is copied from the entry it evicts
+    std::string text(100, 'x');
+    lru_cache<int, std::string> lru(&LibAllocatorV, 1);
+    lru.put(1, text);
+    lru.put(2, *lru.peek(1));
+    REQUIRE(*lru.peek(2) == text);
+    REQUIRE(!lru.has(1));
+
+    clock_cache<int, std::string> clock(&LibAllocatorV, 1);
+    clock.put(1, text);
+    clock.put(2, *clock.peek(1));
+    REQUIRE(*clock.peek(2) == text);
+    REQUIRE(!clock.has(1));
+}
@@ -0,0 +1,90 @@
+#include "freelibcxx/checksum.hpp"
+#include "catch2/internal/catch_run_context.hpp"
+#include "common.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+#include <vector>
+
+using namespace freelibcxx;
+
+namespace
+{
+uint32_t crc32c_bitwise(uint32_t crc, const uint8_t *p, size_t len)
+{
+    crc = ~crc;
+    while (len--)
+    {
+        crc ^= *p++;
+        for (int k = 0; k < 8; k++)
+        {
+            crc = crc & 1 ? (crc >> 1) ^ 0x82f63b78 : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+std::vector<uint8_t> random_bytes(size_t len)
+{
+    std::mt19937_64 rng(Catch::rngSeed());
+    std::vector<uint8_t> data(len);
+    for (auto &b : data)
+    {
+        b = (uint8_t)rng();
+    }
+    return data;
+}
+} // namespace
+
+TEST_CASE("crc32c check value", "checksum")
+{
+    REQUIRE(crc32c(0, "123456789", 9) == 0xe3069283);
+    REQUIRE(crc32c(0, "", 0) == 0);
+}
+
+TEST_CASE("crc32c matches bitwise crc", "checksum")
+{
+    // long enough to run the three stream paths
+    auto data = random_bytes(8192 * 3 * 2 + 256 * 3 + 77);
+    for (size_t offset = 0; offset < 8; offset++)
+    {
+        size_t len = data.size() - offset;
+        REQUIRE(crc32c(0, data.data() + offset, len) == crc32c_bitwise(0, data.data() + offset, len));
+    }
+}
+
+TEST_CASE("crc32c update and combine", "checksum")
+{
+    auto data = random_bytes(10000);
+    uint32_t expect = crc32c(0, data.data(), data.size());
+    for (size_t split : {0UL, 1UL, 13UL, 4096UL, 9999UL, 10000UL})
+    {
+        uint32_t first = crc32c(0, data.data(), split);
+        REQUIRE(crc32c(first, data.data() + split, data.size() - split) == expect);
+        uint32_t second = crc32c(0, data.data() + split, data.size() - split);
+        REQUIRE(crc32c_combine(first, second, data.size() - split) == expect);
+    }
+}
+
+TEST_CASE("adler32", "checksum")
+{
+    REQUIRE(adler32(1, "Wikipedia", 9) == 0x11e60398);
+    REQUIRE(adler32(1, "", 0) == 1);
+
+    auto data = random_bytes(20000);
+    uint32_t a = 1, b = 0;
+    for (auto c : data)
+    {
+        a = (a + c) % 65521;
+        b = (b + a) % 65521;
+    }
+    uint32_t expect = (b << 16) | a;
+    REQUIRE(adler32(1, data.data(), data.size()) == expect);
+
+    for (size_t split : {0UL, 1UL, 5552UL, 12345UL, 20000UL})
+    {
+        uint32_t first = adler32(1, data.data(), split);
+        REQUIRE(adler32(first, data.data() + split, data.size() - split) == expect);
+        uint32_t second = adler32(1, data.data() + split, data.size() - split);
+        REQUIRE(adler32_combine(first, second, data.size() - split) == expect);
+    }
+}
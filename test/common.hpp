@@ -3,17 +3,23 @@
 #include "freelibcxx/allocator.hpp"
 #include "freelibcxx/extern.hpp"
 #include "freelibcxx/utils.hpp"
+#include <cstddef>
+#include <cstdlib>
 
 class LibAllocator : public freelibcxx::Allocator
 {
   public:
     void *allocate(size_t size, size_t align) noexcept
     {
-        void *p = new char[size];
+        if (align < alignof(std::max_align_t))
+        {
+            align = alignof(std::max_align_t);
+        }
+        void *p = std::aligned_alloc(align, (size + align - 1) / align * align);
         memset(p, 1, size);
         return p;
     }
-    void deallocate(void *p) noexcept { delete[](char *) p; }
+    void deallocate(void *p) noexcept { std::free(p); }
 };
 extern LibAllocator LibAllocatorV;
 
@@ -0,0 +1,120 @@
+#include "freelibcxx/concurrent_hash_map.hpp"
+#include "common.hpp"
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <thread>
+#include <vector>
+
+using namespace freelibcxx;
+
+TEST_CASE("insert concurrent hashmap", "concurrent_hashmap")
+{
+    concurrent_hash_map<int, int> map(&LibAllocatorV);
+    REQUIRE(map.size() == 0);
+    REQUIRE(map.insert(1, 2));
+    REQUIRE(!map.insert(1, 3));
+    REQUIRE(map.get(1).value() == 2);
+    REQUIRE(!map.insert_or_assign(1, 3));
+    REQUIRE(map.get(1).value() == 3);
+    REQUIRE(!map.get(2).has_value());
+    REQUIRE(map.size() == 1);
+
+    for (int i = 0; i < 1000; i++)
+    {
+        map.insert_or_assign(i, i);
+    }
+    REQUIRE(map.size() == 1000);
+    REQUIRE(map.capacity() >= 1000);
+    for (int i = 0; i < 1000; i++)
+    {
+        REQUIRE(map.get(i).value() == i);
+    }
+}
+
+TEST_CASE("remove concurrent hashmap", "concurrent_hashmap")
+{
+    concurrent_hash_map<int, int> map(&LibAllocatorV, 100);
+    size_t cap = map.capacity();
+    for (int i = 0; i < 100; i++)
+    {
+        map.insert(i, i);
+    }
+    REQUIRE(map.capacity() == cap);
+    for (int i = 0; i < 100; i += 2)
+    {
+        REQUIRE(map.remove(i));
+    }
+    REQUIRE(!map.remove(0));
+    REQUIRE(map.size() == 50);
+    for (int i = 0; i < 100; i++)
+    {
+        REQUIRE(map.has(i) == (i % 2 == 1));
+    }
+    // reuse removed nodes
+    for (int i = 0; i < 100; i += 2)
+    {
+        REQUIRE(map.insert(i, -i));
+    }
+    REQUIRE(map.get(10).value() == -10);
+}
+
+TEST_CASE("threads concurrent hashmap", "concurrent_hashmap")
+{
+    constexpr int writers = 4;
+    constexpr int readers = 4;
+    constexpr int keys = 20000;
+    concurrent_hash_map<long, long> map(&LibAllocatorV);
+    std::atomic<bool> stop = false;
+    std::atomic<int> bad = 0;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < readers; t++)
+    {
+        threads.emplace_back([&]() {
+            long k = 0;
+            while (!stop.load())
+            {
+                auto v = map.get(k);
+                // value is always key * 3 while present
+                if (v.has_value() && v.value() != k * 3)
+                {
+                    bad++;
+                }
+                k = (k + 7) % keys;
+            }
+        });
+    }
+    for (int t = 0; t < writers; t++)
+    {
+        threads.emplace_back([&, t]() {
+            for (long k = t; k < keys; k += writers)
+            {
+                map.insert(k, k * 3);
+            }
+            for (long k = t; k < keys; k += writers * 2)
+            {
+                map.remove(k);
+            }
+            for (long k = t; k < keys; k += writers * 2)
+            {
+                map.insert_or_assign(k, k * 3);
+            }
+        });
+    }
+    for (int t = readers; t < readers + writers; t++)
+    {
+        threads[t].join();
+    }
+    stop = true;
+    for (int t = 0; t < readers; t++)
+    {
+        threads[t].join();
+    }
+
+    REQUIRE(bad == 0);
+    REQUIRE(map.size() == keys);
+    for (long k = 0; k < keys; k++)
+    {
+        REQUIRE(map.get(k).value() == k * 3);
+    }
+}
@@ -0,0 +1,188 @@
+#include "freelibcxx/concurrent_skip_list.hpp"
+#include "common.hpp"
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <thread>
+#include <vector>
+
+using namespace freelibcxx;
+
+TEST_CASE("insert concurrent skip list", "concurrent_skip_list")
+{
+    concurrent_skip_list<int> list(&LibAllocatorV);
+    REQUIRE(list.empty());
+    REQUIRE(!list.front().has_value());
+    for (int i = 999; i >= 0; i--)
+    {
+        REQUIRE(list.insert(i * 2));
+    }
+    REQUIRE(!list.insert(10));
+    REQUIRE(list.size() == 1000);
+    for (int i = 0; i < 2000; i++)
+    {
+        REQUIRE(list.has(i) == (i % 2 == 0));
+    }
+    REQUIRE(list.find(20).value() == 20);
+    REQUIRE(!list.find(21).has_value());
+    REQUIRE(list.lower_find(21).value() == 22);
+    REQUIRE(!list.lower_find(1999).has_value());
+    REQUIRE(list.front().value() == 0);
+}
+
+TEST_CASE("remove concurrent skip list", "concurrent_skip_list")
+{
+    concurrent_skip_list<int> list(&LibAllocatorV);
+    for (int i = 0; i < 100; i++)
+    {
+        list.insert(i);
+    }
+    for (int i = 0; i < 100; i += 2)
+    {
+        REQUIRE(list.remove(i));
+    }
+    REQUIRE(!list.remove(0));
+    REQUIRE(list.size() == 50);
+    for (int i = 0; i < 100; i++)
+    {
+        REQUIRE(list.has(i) == (i % 2 == 1));
+    }
+    for (int i = 1; i < 100; i += 2)
+    {
+        REQUIRE(list.pop_front().value() == i);
+    }
+    REQUIRE(!list.pop_front().has_value());
+    REQUIRE(list.empty());
+    REQUIRE(list.insert(5));
+    REQUIRE(list.front().value() == 5);
+}
+
+TEST_CASE("threads concurrent skip list", "concurrent_skip_list")
+{
+    constexpr int writers = 4;
+    constexpr int readers = 2;
+    constexpr long keys = 20000;
+    concurrent_skip_list<long> list(&LibAllocatorV);
+    std::atomic<bool> stop = false;
+    std::atomic<int> bad = 0;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < readers; t++)
+    {
+        threads.emplace_back([&]() {
+            while (!stop.load())
+            {
+                // odd keys are never removed once inserted
+                for (long k = 1; k < 200; k += 2)
+                {
+                    auto v = list.lower_find(k);
+                    if (v.has_value() && v.value() < k)
+                    {
+                        bad++;
+                    }
+                }
+            }
+        });
+    }
+    std::vector<std::thread> workers;
+    for (int t = 0; t < writers; t++)
+    {
+        workers.emplace_back([&, t]() {
+            for (long k = t; k < keys; k += writers)
+            {
+                list.insert(k);
+                if (k % 2 == 0)
+                {
+                    // even keys are contended by every writer
+                    list.remove(k);
+                    list.insert(k / 2 * 2);
+                    list.remove((k + 2) / 2 * 2);
+                }
+            }
+        });
+    }
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+    stop = true;
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    REQUIRE(bad == 0);
+    for (long k = 1; k < keys; k += 2)
+    {
+        REQUIRE(list.has(k));
+    }
+    size_t count = 0;
+    while (list.pop_front().has_value())
+    {
+        count++;
+    }
+    REQUIRE(count >= keys / 2);
+    REQUIRE(list.empty());
+}
+
+TEST_CASE("pop concurrent skip list", "concurrent_skip_list")
+{
+    constexpr int threads_count = 4;
+    concurrent_skip_list<long> list(&LibAllocatorV);
+    for (long k = 0; k < 20000; k++)
+    {
+        list.insert(k);
+    }
+    std::atomic<long> sum = 0;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threads_count; t++)
+    {
+        threads.emplace_back([&]() {
+            long last = -1;
+            for (auto v = list.pop_front(); v.has_value(); v = list.pop_front())
+            {
+                // every thread sees an increasing sequence
+                if (v.value() <= last)
+                {
+                    sum -= 1000000000;
+                }
+                last = v.value();
+                sum += v.value();
+            }
+        });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    REQUIRE(sum == 20000L * 19999 / 2);
+    REQUIRE(list.empty());
+}
+
+TEST_CASE("overflow pin concurrent skip list", "concurrent_skip_list")
+{
+    // more threads than epoch slots share the overflow pin
+    constexpr int threads_count = 8;
+    constexpr long keys = 4000;
+    concurrent_skip_list<long, 20, 2> list(&LibAllocatorV);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threads_count; t++)
+    {
+        threads.emplace_back([&, t]() {
+            for (long k = t; k < keys; k += threads_count)
+            {
+                list.insert(k);
+                list.insert(k + keys);
+                list.remove(k + keys);
+            }
+        });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    REQUIRE(list.size() == keys);
+    for (long k = 0; k < keys; k++)
+    {
+        REQUIRE(list.has(k));
+        REQUIRE(!list.has(k + keys));
+    }
+}
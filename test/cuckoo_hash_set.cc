@@ -0,0 +1,121 @@
+#include "freelibcxx/cuckoo_hash_set.hpp"
+#include "catch2/internal/catch_run_context.hpp"
+#include "common.hpp"
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+#include <thread>
+#include <unordered_set>
+
+using namespace freelibcxx;
+
+TEST_CASE("insert cuckoo hash set", "cuckoo_hash_set")
+{
+    cuckoo_hash_set<int> set(&LibAllocatorV);
+    REQUIRE(set.insert(1));
+    REQUIRE(!set.insert(1));
+    REQUIRE(set.has(1));
+    REQUIRE(!set.has(2));
+
+    for (int i = 0; i < 10000; i++)
+    {
+        set.insert(i);
+    }
+    REQUIRE(set.size() == 10000);
+    REQUIRE(set.capacity() >= 10000);
+    for (int i = 0; i < 10000; i++)
+    {
+        REQUIRE(set.has(i));
+    }
+    REQUIRE(!set.has(10000));
+}
+
+TEST_CASE("remove cuckoo hash set", "cuckoo_hash_set")
+{
+    cuckoo_hash_set<uint64_t> set(&LibAllocatorV, 1000);
+    size_t cap = set.capacity();
+    for (uint64_t i = 0; i < 800; i++)
+    {
+        REQUIRE(set.insert(i * 7919));
+    }
+    REQUIRE(set.capacity() == cap);
+    for (uint64_t i = 0; i < 800; i += 2)
+    {
+        REQUIRE(set.remove(i * 7919));
+    }
+    REQUIRE(!set.remove(0));
+    REQUIRE(set.size() == 400);
+    for (uint64_t i = 0; i < 800; i++)
+    {
+        REQUIRE(set.has(i * 7919) == (i % 2 == 1));
+    }
+}
+
+TEST_CASE("random cuckoo hash set", "cuckoo_hash_set")
+{
+    cuckoo_hash_set<uint32_t> set(&LibAllocatorV);
+    std::unordered_set<uint32_t> s;
+    std::mt19937 rng(Catch::rngSeed());
+    for (int i = 0; i < 50000; i++)
+    {
+        uint32_t k = rng() % 20000;
+        if (rng() % 3 == 0)
+        {
+            REQUIRE(set.remove(k) == (s.erase(k) == 1));
+        }
+        else
+        {
+            REQUIRE(set.insert(k) == s.insert(k).second);
+        }
+    }
+    REQUIRE(set.size() == s.size());
+    for (uint32_t k = 0; k < 20000; k++)
+    {
+        REQUIRE(set.has(k) == (s.count(k) == 1));
+    }
+}
+
+TEST_CASE("threads cuckoo hash set", "cuckoo_hash_set")
+{
+    constexpr int readers = 4;
+    constexpr long keys = 50000;
+    cuckoo_hash_set<long> set(&LibAllocatorV);
+    // even keys are inserted first and never removed
+    for (long k = 0; k < keys; k += 2)
+    {
+        set.insert(k);
+    }
+    std::atomic<bool> stop = false;
+    std::atomic<int> bad = 0;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < readers; t++)
+    {
+        threads.emplace_back([&, t]() {
+            long k = t * 2;
+            while (!stop.load())
+            {
+                if (!set.has(k))
+                {
+                    bad++;
+                }
+                k = (k + 14) % keys;
+            }
+        });
+    }
+    // the single writer moves keys around while growing the table
+    for (long k = 1; k < keys * 4; k += 2)
+    {
+        set.insert(k);
+    }
+    for (long k = 1; k < keys * 4; k += 4)
+    {
+        set.remove(k);
+    }
+    stop = true;
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    REQUIRE(bad == 0);
+    REQUIRE(set.size() == keys / 2 + keys);
+}
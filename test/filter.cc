@@ -0,0 +1,168 @@
+#include "freelibcxx/filter.hpp"
+#include "catch2/internal/catch_run_context.hpp"
+#include "common.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <vector>
+
+using namespace freelibcxx;
+
+template <typename Filter> size_t false_positives(const Filter &filter, uint64_t beg, uint64_t end)
+{
+    size_t count = 0;
+    for (uint64_t k = beg; k < end; k++)
+    {
+        count += filter.may_contain(k);
+    }
+    return count;
+}
+
+TEST_CASE("bloom filter", "filter")
+{
+    for (bool blocked : {false, true})
+    {
+        bloom_filter filter(&LibAllocatorV, 10000, 10, blocked);
+        for (uint64_t k = 0; k < 10000; k++)
+        {
+            filter.add(k);
+        }
+        for (uint64_t k = 0; k < 10000; k++)
+        {
+            REQUIRE(filter.may_contain(k));
+        }
+        REQUIRE(filter.size() == 10000);
+        REQUIRE(filter.bit_size() == 100352);
+        // 1% expected, a little more for the blocked layout
+        REQUIRE(false_positives(filter, 10000, 110000) < (blocked ? 1500 : 1200));
+
+        const char *str = "key";
+        filter.add(str, strlen(str));
+        REQUIRE(filter.may_contain(str, strlen(str)));
+
+        filter.clear();
+        REQUIRE(!filter.may_contain((uint64_t)1));
+    }
+}
+
+TEST_CASE("bloom filter bulk", "filter")
+{
+    bloom_filter filter(&LibAllocatorV, 1000, 16, true);
+    std::vector<uint32_t> keys;
+    for (uint32_t k = 0; k < 1000; k++)
+    {
+        keys.push_back(k * 3);
+    }
+    filter.add_many(span<const uint32_t>(keys.data(), keys.size()));
+    keys.push_back(1);
+    keys.push_back(2);
+    bool result[1002];
+    size_t found = filter.may_contain_many(span<const uint32_t>(keys.data(), keys.size()), span<bool>(result, 1002));
+    REQUIRE(found >= 1000);
+    for (size_t i = 0; i < 1000; i++)
+    {
+        REQUIRE(result[i]);
+    }
+}
+
+TEST_CASE("bloom filter serialize", "filter")
+{
+    bloom_filter filter(&LibAllocatorV, 500, 12, true);
+    for (uint64_t k = 0; k < 500; k++)
+    {
+        filter.add(k);
+    }
+    std::vector<std::byte> bytes(filter.serialized_size());
+    REQUIRE(filter.serialize(span<std::byte>(bytes.data(), bytes.size() - 1)) == 0);
+    REQUIRE(filter.serialize(span<std::byte>(bytes.data(), bytes.size())) == bytes.size());
+
+    auto loaded = bloom_filter::from_bytes(&LibAllocatorV, span<const std::byte>(bytes.data(), bytes.size()));
+    REQUIRE(loaded.has_value());
+    REQUIRE(loaded->size() == 500);
+    REQUIRE(loaded->probes() == filter.probes());
+    for (uint64_t k = 0; k < 1000; k++)
+    {
+        REQUIRE(loaded->may_contain(k) == filter.may_contain(k));
+    }
+    REQUIRE(!bloom_filter::from_bytes(&LibAllocatorV, span<const std::byte>(bytes.data(), 10)).has_value());
+    bytes[0] = std::byte{0};
+    REQUIRE(!bloom_filter::from_bytes(&LibAllocatorV, span<const std::byte>(bytes.data(), bytes.size())).has_value());
+}
+
+TEST_CASE("cuckoo filter", "filter")
+{
+    cuckoo_filter<uint16_t> filter(&LibAllocatorV, 10000);
+    for (uint64_t k = 0; k < 10000; k++)
+    {
+        REQUIRE(filter.add(k));
+    }
+    for (uint64_t k = 0; k < 10000; k++)
+    {
+        REQUIRE(filter.may_contain(k));
+    }
+    REQUIRE(false_positives(filter, 10000, 110000) < 100);
+
+    for (uint64_t k = 0; k < 10000; k += 2)
+    {
+        REQUIRE(filter.remove(k));
+    }
+    REQUIRE(filter.size() == 5000);
+    for (uint64_t k = 1; k < 10000; k += 2)
+    {
+        REQUIRE(filter.may_contain(k));
+    }
+    size_t removed_found = 0;
+    for (uint64_t k = 0; k < 10000; k += 2)
+    {
+        removed_found += filter.may_contain(k);
+    }
+    REQUIRE(removed_found < 50);
+}
+
+TEST_CASE("cuckoo filter full", "filter")
+{
+    cuckoo_filter<uint8_t> filter(&LibAllocatorV, 100);
+    std::vector<uint64_t> keys;
+    for (uint64_t k = 0; k < 1000; k++)
+    {
+        keys.push_back(k);
+    }
+    size_t added = filter.add_many(span<const uint64_t>(keys.data(), keys.size()));
+    REQUIRE(added < 1000);
+    REQUIRE(added >= filter.capacity() * 8 / 10);
+    REQUIRE(!filter.add((uint64_t)5000));
+    for (size_t k = 0; k < added; k++)
+    {
+        REQUIRE(filter.may_contain(keys[k]));
+    }
+    // a removal makes room again
+    REQUIRE(filter.remove(keys[0]));
+    REQUIRE(filter.add(keys[0]));
+    for (size_t k = 0; k < added; k++)
+    {
+        REQUIRE(filter.may_contain(keys[k]));
+    }
+
+    bool result[1000];
+    REQUIRE(filter.may_contain_many(span<const uint64_t>(keys.data(), added), span<bool>(result, 1000)) == added);
+}
+
+TEST_CASE("cuckoo filter serialize", "filter")
+{
+    cuckoo_filter<uint16_t> filter(&LibAllocatorV, 300);
+    for (uint64_t k = 0; k < 300; k++)
+    {
+        filter.add(k);
+    }
+    std::vector<std::byte> bytes(filter.serialized_size());
+    REQUIRE(filter.serialize(span<std::byte>(bytes.data(), bytes.size())) == bytes.size());
+
+    auto loaded = cuckoo_filter<uint16_t>::from_bytes(&LibAllocatorV, span<const std::byte>(bytes.data(), bytes.size()));
+    REQUIRE(loaded.has_value());
+    REQUIRE(loaded->size() == 300);
+    for (uint64_t k = 0; k < 600; k++)
+    {
+        REQUIRE(loaded->may_contain(k) == filter.may_contain(k));
+    }
+    REQUIRE(!cuckoo_filter<uint32_t>::from_bytes(&LibAllocatorV, span<const std::byte>(bytes.data(), bytes.size()))
+                 .has_value());
+}
@@ -0,0 +1,113 @@
+#include "freelibcxx/flat_map.hpp"
+#include "catch2/internal/catch_run_context.hpp"
+#include "common.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <map>
+#include <random>
+
+using namespace freelibcxx;
+
+TEST_CASE("insert flat map", "flat_map")
+{
+    flat_map<int, int> map(&LibAllocatorV, {{3, 4}, {1, 2}, {5, 6}});
+    REQUIRE(map.size() == 3);
+    REQUIRE(map.get(1).value() == 2);
+    REQUIRE(map.get(3).value() == 4);
+    REQUIRE(!map.get(2).has_value());
+
+    auto [it, inserted] = map.insert(2, 3);
+    REQUIRE(inserted);
+    REQUIRE(it->key == 2);
+    REQUIRE(!map.insert(2, 10).second);
+    REQUIRE(map.get(2).value() == 3);
+
+    REQUIRE(!map.insert_or_assign(2, 10).second);
+    REQUIRE(map.get(2).value() == 10);
+    REQUIRE(map.insert_or_assign(0, 1).second);
+
+    int prev = -1;
+    for (auto &item : map)
+    {
+        REQUIRE(prev < item.key);
+        prev = item.key;
+    }
+    REQUIRE(map.size() == 5);
+}
+
+TEST_CASE("remove flat map", "flat_map")
+{
+    flat_map<int, Int> map(&LibAllocatorV);
+    for (int i = 0; i < 10; i++)
+    {
+        map.insert(i, Int(i));
+    }
+    REQUIRE(map.remove(3));
+    REQUIRE(!map.remove(3));
+    REQUIRE(!map.has(3));
+    REQUIRE(map.get_ptr(4)->v == 4);
+    REQUIRE(map.size() == 9);
+    REQUIRE(map.find(3) == map.end());
+}
+
+TEST_CASE("random flat map", "flat_map")
+{
+    flat_map<int, int> map(&LibAllocatorV);
+    std::map<int, int> m;
+    std::mt19937 rng(Catch::rngSeed());
+    for (int i = 0; i < 2000; i++)
+    {
+        int k = rng() % 500;
+        if (rng() % 3 == 0)
+        {
+            REQUIRE(map.remove(k) == (m.erase(k) == 1));
+        }
+        else
+        {
+            map.insert_or_assign(k, i);
+            m[k] = i;
+        }
+    }
+    REQUIRE(map.size() == m.size());
+    auto it = map.begin();
+    for (auto &[k, v] : m)
+    {
+        REQUIRE(it->key == k);
+        REQUIRE(it->value == v);
+        ++it;
+    }
+}
+
+TEST_CASE("insert sorted flat map", "flat_map")
+{
+    flat_map<int, int> map(&LibAllocatorV, {{2, 0}, {4, 0}, {6, 0}});
+    flat_map_pair<int, int> items[] = {{1, 1}, {2, 1}, {3, 1}, {7, 1}};
+    map.insert_sorted(span<const flat_map_pair<int, int>>(items, 4));
+    REQUIRE(map.size() == 6);
+    int keys[] = {1, 2, 3, 4, 6, 7};
+    int values[] = {1, 0, 1, 0, 0, 1};
+    for (int i = 0; i < 6; i++)
+    {
+        REQUIRE(map.at(i).key == keys[i]);
+        REQUIRE(map.at(i).value == values[i]);
+    }
+}
+
+TEST_CASE("adopt sorted flat set", "flat_map")
+{
+    vector<flat_set_pair<int>> v(&LibAllocatorV);
+    for (int i = 0; i < 100; i += 2)
+    {
+        v.push_back(i);
+    }
+    flat_set<int> set(&LibAllocatorV);
+    set.adopt_sorted(std::move(v));
+    REQUIRE(set.size() == 50);
+    REQUIRE(set.has(10));
+    REQUIRE(!set.has(11));
+    REQUIRE(set.lower_find(11)->key == 12);
+    REQUIRE(set.insert(11).second);
+    REQUIRE(set.size() == 51);
+
+    vector<flat_set_pair<int>> unsorted(&LibAllocatorV, {2, 1});
+    REQUIRE_THROWS(set.adopt_sorted(std::move(unsorted)));
+}
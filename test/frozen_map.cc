@@ -0,0 +1,68 @@
+#include "freelibcxx/frozen_map.hpp"
+#include "common.hpp"
+#include <catch2/catch_test_macros.hpp>
+
+using namespace freelibcxx;
+
+namespace
+{
+enum class errno_t
+{
+    perm = 1,
+    noent = 2,
+    io = 5,
+};
+
+struct large_entries
+{
+    frozen_map_entry<int, int> entries[300];
+};
+
+constexpr large_entries make_large()
+{
+    large_entries e = {};
+    for (int i = 0; i < 300; i++)
+    {
+        e.entries[i] = {i * 7919 - 1000, i};
+    }
+    return e;
+}
+} // namespace
+
+TEST_CASE("frozen map integral", "frozen_map")
+{
+    static constexpr auto map = make_frozen_map<errno_t, const char *>(
+        {{errno_t::perm, "EPERM"}, {errno_t::noent, "ENOENT"}, {errno_t::io, "EIO"}});
+    REQUIRE(map.size() == 3);
+    REQUIRE(strcmp(*map.get(errno_t::perm), "EPERM") == 0);
+    REQUIRE(strcmp(*map.get(errno_t::noent), "ENOENT") == 0);
+    REQUIRE(strcmp(*map.get(errno_t::io), "EIO") == 0);
+    REQUIRE(map.get((errno_t)3) == nullptr);
+    REQUIRE(!map.has((errno_t)0));
+}
+
+TEST_CASE("frozen map string", "frozen_map")
+{
+    static constexpr auto map =
+        make_frozen_map<const char *, int>({{"read", 0}, {"write", 1}, {"open", 2}, {"close", 3}, {"", 4}});
+    REQUIRE(*map.get("read") == 0);
+    REQUIRE(*map.get("write") == 1);
+    REQUIRE(*map.get("open") == 2);
+    REQUIRE(*map.get("close") == 3);
+    REQUIRE(*map.get("") == 4);
+    REQUIRE(map.get("reads") == nullptr);
+    REQUIRE(map.get("rea") == nullptr);
+    REQUIRE(map.has(const_string_view("opened", 4)));
+}
+
+TEST_CASE("frozen map large", "frozen_map")
+{
+    static constexpr auto map = make_frozen_map(make_large().entries);
+    for (int i = 0; i < 300; i++)
+    {
+        auto v = map.get(i * 7919 - 1000);
+        REQUIRE(v != nullptr);
+        REQUIRE(*v == i);
+        REQUIRE(map.get(i * 7919 - 999) == nullptr);
+    }
+}
@@ -0,0 +1,184 @@
+#include "freelibcxx/hash.hpp"
+#include "catch2/internal/catch_run_context.hpp"
+#include "common.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+#include <vector>
+
+using namespace freelibcxx;
+
+namespace
+{
+enum class color : uint8_t
+{
+    red,
+    green,
+};
+
+// chi-square of hashes of [0, n) over buckets
+template <typename T> double chi_square(size_t n, size_t buckets, size_t stride)
+{
+    std::vector<size_t> count(buckets);
+    for (size_t i = 0; i < n; i++)
+    {
+        count[hasher<T>()(static_cast<T>(i * stride)) % buckets]++;
+    }
+    double expect = (double)n / buckets;
+    double chi = 0;
+    for (auto c : count)
+    {
+        chi += (c - expect) * (c - expect) / expect;
+    }
+    return chi;
+}
+} // namespace
+
+TEST_CASE("integral hasher is constexpr", "hash")
+{
+    static_assert(hasher<int>()(1) != hasher<int>()(2));
+    static_assert(hasher<unsigned long>()(0) == 0);
+    static_assert(hasher<color>()(color::red) != hasher<color>()(color::green));
+    static_assert(hasher<__int128>()(1) != hasher<__int128>()((__int128)1 << 64));
+    REQUIRE(hasher<long>()(-1) == hasher<unsigned long>()((unsigned long)-1));
+}
+
+TEST_CASE("pointer hasher", "hash")
+{
+    int values[2];
+    REQUIRE(hasher<int *>()(&values[0]) != hasher<int *>()(&values[1]));
+    REQUIRE(hasher<int *>()(&values[0]) == hasher<int *>()(&values[0]));
+}
+
+TEST_CASE("integral hasher distribution", "hash")
+{
+    // 1023 degrees of freedom, the critical value at p=0.001 is about 1170
+    REQUIRE(chi_square<int>(1 << 16, 1024, 1) < 1170);
+    REQUIRE(chi_square<unsigned long>(1 << 16, 1024, 1024) < 1170);
+    REQUIRE(chi_square<unsigned long>(1 << 16, 1024, 4096) < 1170);
+}
+
+TEST_CASE("integral hasher avalanche", "hash")
+{
+    uint64_t total = 0;
+    uint64_t rounds = 0;
+    for (uint64_t i = 1; i < 1000; i++)
+    {
+        uint64_t key = i * 0x9E3779B97F4A7C15;
+        uint64_t h = hasher<uint64_t>()(key);
+        for (int bit = 0; bit < 64; bit++)
+        {
+            total += __builtin_popcountl(h ^ hasher<uint64_t>()(key ^ (1UL << bit)));
+            rounds++;
+        }
+    }
+    double avg = (double)total / rounds;
+    REQUIRE(avg > 31);
+    REQUIRE(avg < 33);
+}
+
+TEST_CASE("wyhash", "hash")
+{
+    alignas(8) char buf[256 + 8];
+    for (size_t i = 0; i < sizeof(buf); i++)
+    {
+        buf[i] = (char)(i * 131 + 7);
+    }
+    std::vector<uint64_t> seen;
+    for (size_t len = 0; len <= 256; len++)
+    {
+        uint64_t h = detail::wyhash(buf, len, 0);
+        // same bytes at another alignment
+        char moved[256 + 8];
+        memcpy(moved + 3, buf, len);
+        REQUIRE(detail::wyhash(moved + 3, len, 0) == h);
+        REQUIRE(detail::wyhash(buf, len, 1) != h);
+        for (auto s : seen)
+        {
+            REQUIRE(s != h);
+        }
+        seen.push_back(h);
+    }
+}
+
+TEST_CASE("wyhash known answer", "hash")
+{
+    // test_vector.cpp of wyhash final version 4, the seed is the index
+    struct
+    {
+        const char *message;
+        uint64_t hash;
+    } vectors[] = {
+        {"", 0x93228a4de0eec5a2},
+        {"a", 0xc5bac3db178713c4},
+        {"abc", 0xa97f2f7b1d9b3314},
+        {"message digest", 0x786d1f1df3801df4},
+        {"abcdefghijklmnopqrstuvwxyz", 0xdca5a8138ad37c87},
+        {"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", 0xb9e734f117cfaf70},
+        {"12345678901234567890123456789012345678901234567890123456789012345678901234567890", 0x6cc5eab49a92d617},
+    };
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++)
+    {
+        const char *message = vectors[i].message;
+        size_t len = strlen(message);
+        REQUIRE(detail::wyhash((const void *)message, len, i) == vectors[i].hash);
+        REQUIRE(detail::wyhash(message, len, i) == vectors[i].hash);
+        wyhash_state state(i);
+        state.update(span<const std::byte>((const std::byte *)message, len));
+        REQUIRE(state.finish() == vectors[i].hash);
+    }
+    static_assert(detail::wyhash("abc", 3, 2) == 0xa97f2f7b1d9b3314);
+}
+
+TEST_CASE("murmur hash unaligned", "hash")
+{
+    alignas(8) char buf[64 + 8];
+    for (size_t i = 0; i < sizeof(buf); i++)
+    {
+        buf[i] = (char)(i * 17 + 1);
+    }
+    char moved[64 + 8];
+    memcpy(moved + 1, buf, 64);
+    REQUIRE(detail::murmur_hash2_64(buf, 64, 0) == detail::murmur_hash2_64(moved + 1, 64, 0));
+    uint64_t a[2], b[2];
+    detail::murmur_hash3_128(buf, 64, 0, a);
+    detail::murmur_hash3_128(moved + 1, 64, 0, b);
+    REQUIRE(a[0] == b[0]);
+    REQUIRE(a[1] == b[1]);
+}
+
+TEST_CASE("incremental hash", "hash")
+{
+    std::mt19937_64 rng(Catch::rngSeed());
+    std::vector<std::byte> data(1024);
+    for (auto &b : data)
+    {
+        b = (std::byte)rng();
+    }
+
+    for (size_t len = 0; len <= data.size(); len += 1 + len / 8)
+    {
+        uint64_t expect_murmur[2];
+        detail::murmur_hash3_128(data.data(), len, 7, expect_murmur);
+        uint64_t expect_wy = detail::wyhash(data.data(), len, 7);
+
+        for (int round = 0; round < 4; round++)
+        {
+            murmur3_128_state murmur(7);
+            wyhash_state wy(7);
+            size_t offset = 0;
+            while (offset < len)
+            {
+                size_t n = min<size_t>(len - offset, rng() % 70);
+                span<const std::byte> chunk(data.data() + offset, n);
+                murmur.update(chunk);
+                wy.update(chunk);
+                offset += n;
+            }
+            uint64_t out[2];
+            murmur.finish(out);
+            REQUIRE(out[0] == expect_murmur[0]);
+            REQUIRE(out[1] == expect_murmur[1]);
+            REQUIRE(wy.finish() == expect_wy);
+        }
+    }
+}
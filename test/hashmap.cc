@@ -6,6 +6,7 @@
 #include <catch2/catch_test_macros.hpp>
 #include <random>
 #include <unordered_map>
+#include <vector>
 
 using namespace freelibcxx;
 
@@ -150,4 +151,182 @@ TEST_CASE("string key hashmap", "hashmap")
         REQUIRE(val.has_value());
         REQUIRE(val.value() == item.second);
     }
-}
\ No newline at end of file
+}
+TEST_CASE("try emplace hashmap", "hashmap")
+{
+    hash_map<int, int> map(&LibAllocatorV);
+    auto [it, inserted] = map.try_emplace(1, 10);
+    REQUIRE(inserted);
+    REQUIRE(it->key == 1);
+    REQUIRE(it->value == 10);
+
+    auto [it2, inserted2] = map.try_emplace(1, 20);
+    REQUIRE(!inserted2);
+    REQUIRE(it2->value == 10);
+    REQUIRE(map.size() == 1);
+
+    for (int i = 2; i < 100; i++)
+    {
+        REQUIRE(map.try_emplace(i, i).second);
+    }
+    REQUIRE(map.size() == 99);
+    REQUIRE(map.key_count(50) == 1);
+
+    hash_set<int> set(&LibAllocatorV);
+    REQUIRE(set.try_emplace(3).second);
+    REQUIRE(!set.try_emplace(3).second);
+    REQUIRE(set.size() == 1);
+}
+
+TEST_CASE("find hashmap", "hashmap")
+{
+    hash_map<int, int> map(&LibAllocatorV);
+    REQUIRE(map.find(1) == map.end());
+    map.insert(1, 2);
+    map.insert(3, 4);
+    auto it = map.find(3);
+    REQUIRE(it != map.end());
+    REQUIRE(it->value == 4);
+    it->value = 5;
+    REQUIRE(map.get(3).value() == 5);
+    REQUIRE(map.find(2) == map.end());
+}
+
+TEST_CASE("insert or assign hashmap", "hashmap")
+{
+    hash_map<int, Int> map(&LibAllocatorV);
+    auto [it, inserted] = map.insert_or_assign(1, Int(1));
+    REQUIRE(inserted);
+    REQUIRE(it->value.v == 1);
+
+    auto [it2, inserted2] = map.insert_or_assign(1, Int(2));
+    REQUIRE(!inserted2);
+    REQUIRE(it2->value.v == 2);
+    REQUIRE(map.size() == 1);
+    REQUIRE(map.get_ptr(1)->v == 2);
+}
+
+TEST_CASE("get or insert with hashmap", "hashmap")
+{
+    hash_map<int, int> map(&LibAllocatorV);
+    int calls = 0;
+    auto factory = [&calls]() {
+        calls++;
+        return 0;
+    };
+    for (int i = 0; i < 1000; i++)
+    {
+        map.get_or_insert_with(i % 10, factory)++;
+    }
+    REQUIRE(calls == 10);
+    REQUIRE(map.size() == 10);
+    for (int i = 0; i < 10; i++)
+    {
+        REQUIRE(map.get(i).value() == 100);
+    }
+}
+
+TEST_CASE("reserve hashmap", "hashmap")
+{
+    hash_map<int, int> map(&LibAllocatorV, 100);
+    size_t cap = map.capacity();
+    REQUIRE(cap >= 100);
+    for (int i = 0; i < 100; i++)
+    {
+        map.insert(i, i);
+    }
+    REQUIRE(map.capacity() == cap);
+
+    map.reserve(1000);
+    REQUIRE(map.capacity() >= 1000);
+    for (int i = 0; i < 100; i++)
+    {
+        REQUIRE(map.get(i).value() == i);
+    }
+
+    for (int i = 10; i < 100; i++)
+    {
+        map.remove(i);
+    }
+    map.shrink_to_fit();
+    REQUIRE(map.capacity() < cap);
+    REQUIRE(map.size() == 10);
+    for (int i = 0; i < 10; i++)
+    {
+        REQUIRE(map.get(i).value() == i);
+    }
+
+    map.clear();
+    map.shrink_to_fit();
+    REQUIRE(map.capacity() == 0);
+    map.insert(1, 1);
+    REQUIRE(map.has(1));
+
+    // no rehash up to exactly the reserved count
+    for (int n = 1; n < 200; n++)
+    {
+        hash_map<int, int> small(&LibAllocatorV, n);
+        size_t reserved = small.capacity();
+        for (int i = 0; i < n; i++)
+        {
+            small.insert(i, i);
+        }
+        REQUIRE(small.capacity() == reserved);
+    }
+}
+
+TEST_CASE("build hashmap", "hashmap")
+{
+    std::vector<hash_map_pair<int, int>> items;
+    for (int i = 0; i < 1000; i++)
+    {
+        items.emplace_back(i, i * 2);
+    }
+    hash_map<int, int> map(&LibAllocatorV, span<const hash_map_pair<int, int>>(items.data(), items.size()));
+    REQUIRE(map.size() == 1000);
+    size_t cap = map.capacity();
+    for (int i = 0; i < 1000; i++)
+    {
+        REQUIRE(map.get(i).value() == i * 2);
+    }
+    map.insert(1000, 0);
+    REQUIRE(map.capacity() == cap);
+
+    int count = 0;
+    for (auto &item : map)
+    {
+        (void)item;
+        count++;
+    }
+    REQUIRE(count == 1001);
+}
+
+TEST_CASE("get many hashmap", "hashmap")
+{
+    hash_map<int, int> map(&LibAllocatorV);
+    std::vector<int> keys;
+    std::vector<int *> values(100);
+    REQUIRE(map.get_many(span<const int>(keys.data(), keys.size()), span<int *>(values.data(), values.size())) == 0);
+
+    for (int i = 0; i < 100; i++)
+    {
+        keys.push_back(i);
+        if (i % 3 == 0)
+        {
+            map.insert(i, i + 1);
+        }
+    }
+    REQUIRE(map.get_many(span<const int>(keys.data(), keys.size()), span<int *>(values.data(), values.size())) == 34);
+    for (int i = 0; i < 100; i++)
+    {
+        if (i % 3 == 0)
+        {
+            REQUIRE(values[i] != nullptr);
+            REQUIRE(*values[i] == i + 1);
+        }
+        else
+        {
+            REQUIRE(values[i] == nullptr);
+        }
+    }
+}
@@ -0,0 +1,155 @@
+#include "freelibcxx/interval_tree.hpp"
+#include "catch2/internal/catch_run_context.hpp"
+#include "common.hpp"
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace freelibcxx;
+
+using range = std::pair<int, int>;
+
+static std::vector<range> overlaps(interval_tree<int, int> &tree, int start, int end)
+{
+    std::vector<range> result;
+    tree.for_each_overlap(start, end, [&](interval_entry<int, int> &entry) {
+        REQUIRE(entry.value == entry.start * 1000 + entry.end);
+        result.emplace_back(entry.start, entry.end);
+    });
+    return result;
+}
+
+TEST_CASE("overlap interval tree", "interval_tree")
+{
+    interval_tree<int, Int> tree(&LibAllocatorV);
+    REQUIRE(tree.empty());
+    REQUIRE(tree.first_overlap(0, 10) == nullptr);
+    tree.insert(10, 20, 1);
+    tree.insert(15, 25, 2);
+    tree.insert(30, 40, 3);
+    tree.insert(0, 5, 4);
+    tree.insert(18, 19, 5);
+    REQUIRE(tree.size() == 5);
+
+    REQUIRE(tree.first_overlap(19, 31)->value.v == 1);
+    REQUIRE(tree.first_overlap(20, 30)->value.v == 2);
+    REQUIRE(tree.first_overlap(25, 30) == nullptr);
+    REQUIRE(tree.first_overlap(5, 10) == nullptr);
+    REQUIRE(!tree.has_overlap(40, 100));
+    REQUIRE(!tree.has_overlap(12, 12));
+
+    std::vector<int> values;
+    tree.for_each_overlap(16, 31, [&](interval_entry<int, Int> &entry) { values.push_back(entry.value.v); });
+    REQUIRE(values == std::vector<int>{1, 2, 5, 3});
+    values.clear();
+    tree.for_each_stab(18, [&](interval_entry<int, Int> &entry) { values.push_back(entry.value.v); });
+    REQUIRE(values == std::vector<int>{1, 2, 5});
+    values.clear();
+    tree.for_each_stab(20, [&](interval_entry<int, Int> &entry) { values.push_back(entry.value.v); });
+    REQUIRE(values == std::vector<int>{2});
+
+    REQUIRE(!tree.remove(15, 24));
+    REQUIRE(tree.remove(15, 25));
+    REQUIRE(tree.first_overlap(20, 30) == nullptr);
+    auto it = tree.remove(tree.begin());
+    REQUIRE(it->start == 10);
+    REQUIRE(tree.size() == 3);
+}
+
+TEST_CASE("random interval tree", "interval_tree")
+{
+    interval_tree<int, int> tree(&LibAllocatorV);
+    std::vector<range> expect;
+    std::mt19937 rng(Catch::rngSeed());
+    for (int i = 0; i < 20000; i++)
+    {
+        int start = rng() % 1000;
+        int end = start + rng() % 50;
+        if (rng() % 3 == 0 && !expect.empty())
+        {
+            size_t index = rng() % expect.size();
+            REQUIRE(tree.remove(expect[index].first, expect[index].second));
+            expect.erase(expect.begin() + index);
+        }
+        else
+        {
+            tree.insert(start, end, start * 1000 + end);
+            expect.emplace_back(start, end);
+        }
+        if (i % 200 == 0)
+        {
+            REQUIRE(tree.size() == expect.size());
+            std::vector<range> brute;
+            for (auto &r : expect)
+            {
+                if (start < end && r.first < end && start < r.second)
+                {
+                    brute.push_back(r);
+                }
+            }
+            auto found = overlaps(tree, start, end);
+            std::sort(brute.begin(), brute.end());
+            std::sort(found.begin(), found.end());
+            REQUIRE(found == brute);
+            auto first = std::min_element(brute.begin(), brute.end());
+            auto *entry = tree.first_overlap(start, end);
+            REQUIRE((entry == nullptr) == brute.empty());
+            if (entry != nullptr)
+            {
+                REQUIRE(entry->start == first->first);
+            }
+        }
+    }
+
+    interval_tree<int, int> copy = tree;
+    REQUIRE(copy.size() == tree.size());
+    REQUIRE(overlaps(copy, 0, 2000).size() == expect.size());
+    interval_tree<int, int> moved = std::move(copy);
+    REQUIRE(copy.empty());
+    REQUIRE(moved.size() == expect.size());
+}
+
+TEST_CASE("build interval tree", "interval_tree")
+{
+    for (size_t n : {0, 1, 2, 7, 1000})
+    {
+        std::vector<interval_entry<int, int>> entries;
+        for (size_t i = 0; i < n; i++)
+        {
+            int start = i * 2;
+            int end = start + (i % 5) * 3;
+            entries.emplace_back(start, end, start * 1000 + end);
+        }
+        interval_tree<int, int> tree(&LibAllocatorV);
+        tree.insert(-10, 10000, -10 * 1000 + 10000);
+        tree.build_sorted(span<const interval_entry<int, int>>(entries.data(), n));
+        REQUIRE(tree.size() == n);
+        size_t i = 0;
+        for (auto it = tree.begin(); it != tree.end(); ++it, i++)
+        {
+            REQUIRE(it->start == entries[i].start);
+        }
+        REQUIRE(i == n);
+        for (int point = 0; point < (int)n * 2; point += 7)
+        {
+            size_t count = 0;
+            for (auto &entry : entries)
+            {
+                count += entry.start <= point && point < entry.end;
+            }
+            size_t found = 0;
+            tree.for_each_stab(point, [&](interval_entry<int, int> &) { found++; });
+            REQUIRE(found == count);
+        }
+        // the built tree stays balanced under updates
+        for (size_t i = 0; i < n; i += 2)
+        {
+            REQUIRE(tree.remove(entries[i].start, entries[i].end));
+            tree.insert(entries[i].start + 1, entries[i].start + 4, (entries[i].start + 1) * 1000 + entries[i].start + 4);
+        }
+        REQUIRE(tree.size() == n);
+        REQUIRE(overlaps(tree, 0, n * 2).size() == n);
+    }
+}
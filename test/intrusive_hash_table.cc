@@ -0,0 +1,128 @@
+#include "freelibcxx/intrusive_hash_table.hpp"
+#include "catch2/internal/catch_run_context.hpp"
+#include "common.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+using namespace freelibcxx;
+
+struct task
+{
+    int pid;
+    hash_hook pid_hook;
+    int group;
+    hash_hook group_hook;
+};
+
+struct task_pid
+{
+    int operator()(const task &t) const { return t.pid; }
+};
+
+struct task_group
+{
+    int operator()(const task &t) const { return t.group; }
+};
+
+using pid_table = intrusive_hash_table<task, &task::pid_hook, task_pid>;
+using group_table = intrusive_hash_table<task, &task::group_hook, task_group>;
+
+TEST_CASE("insert intrusive hash table", "intrusive_hash_table")
+{
+    task tasks[100];
+    pid_table table(&LibAllocatorV);
+    for (int i = 0; i < 100; i++)
+    {
+        tasks[i].pid = i;
+        REQUIRE(table.insert(tasks[i]));
+        REQUIRE(tasks[i].pid_hook.is_linked());
+    }
+    REQUIRE(table.size() == 100);
+    task dup;
+    dup.pid = 10;
+    REQUIRE(!table.insert(dup));
+    REQUIRE(!dup.pid_hook.is_linked());
+
+    for (int i = 0; i < 100; i++)
+    {
+        REQUIRE(table.find(i) == &tasks[i]);
+    }
+    REQUIRE(table.find(100) == nullptr);
+
+    REQUIRE(table.insert_or_replace(dup) == &tasks[10]);
+    REQUIRE(!tasks[10].pid_hook.is_linked());
+    REQUIRE(table.find(10) == &dup);
+    REQUIRE(table.size() == 100);
+
+    size_t count = 0;
+    for (auto &t : table)
+    {
+        REQUIRE(table.find(t.pid) == &t);
+        count++;
+    }
+    REQUIRE(count == 100);
+
+    table.clear();
+    REQUIRE(table.empty());
+    REQUIRE(!tasks[0].pid_hook.is_linked());
+    REQUIRE(table.begin() == table.end());
+}
+
+TEST_CASE("remove intrusive hash table", "intrusive_hash_table")
+{
+    task tasks[64];
+    hash_hook *buckets[16];
+    pid_table pids(span<hash_hook *>(buckets, 16));
+    group_table groups(&LibAllocatorV, 64);
+    for (int i = 0; i < 64; i++)
+    {
+        tasks[i].pid = i;
+        tasks[i].group = i;
+        pids.insert(tasks[i]);
+        groups.insert(tasks[i]);
+    }
+    REQUIRE(pids.capacity() == 16);
+
+    pids.remove(tasks[5]);
+    REQUIRE(!pids.has(5));
+    REQUIRE(groups.has(5));
+    REQUIRE(pids.remove(6) == &tasks[6]);
+    REQUIRE(pids.remove(6) == nullptr);
+    REQUIRE(pids.size() == 62);
+    REQUIRE(groups.size() == 64);
+    REQUIRE(pid_table::owner_of(&tasks[7].pid_hook) == &tasks[7]);
+    REQUIRE(group_table::owner_of(&tasks[7].group_hook) == &tasks[7]);
+}
+
+TEST_CASE("random intrusive hash table", "intrusive_hash_table")
+{
+    std::vector<task> tasks(1000);
+    pid_table table(&LibAllocatorV);
+    std::unordered_set<int> linked;
+    std::mt19937 rng(Catch::rngSeed());
+    for (int i = 0; i < 1000; i++)
+    {
+        tasks[i].pid = i;
+    }
+    for (int i = 0; i < 20000; i++)
+    {
+        int k = rng() % 1000;
+        if (linked.count(k))
+        {
+            table.remove(tasks[k]);
+            linked.erase(k);
+        }
+        else
+        {
+            REQUIRE(table.insert(tasks[k]));
+            linked.insert(k);
+        }
+        REQUIRE(table.size() == linked.size());
+    }
+    for (int i = 0; i < 1000; i++)
+    {
+        REQUIRE(table.has(i) == (linked.count(i) == 1));
+    }
+}
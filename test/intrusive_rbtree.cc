@@ -0,0 +1,207 @@
+#include "freelibcxx/intrusive_rbtree.hpp"
+#include "catch2/internal/catch_run_context.hpp"
+#include "common.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace freelibcxx;
+
+struct rb_item
+{
+    int key;
+    size_t count = 1;
+    rb_hook hook;
+};
+
+struct rb_item_less
+{
+    bool operator()(const rb_item &a, const rb_item &b) const { return a.key < b.key; }
+    bool operator()(const rb_item &a, int b) const { return a.key < b; }
+    bool operator()(int a, const rb_item &b) const { return a < b.key; }
+};
+
+struct rb_count_augment
+{
+    bool operator()(rb_item &item, rb_item *left, rb_item *right) const
+    {
+        size_t count = 1 + (left ? left->count : 0) + (right ? right->count : 0);
+        bool changed = count != item.count;
+        item.count = count;
+        return changed;
+    }
+};
+
+using rb_tree = intrusive_rbtree<rb_item, &rb_item::hook, rb_item_less, rb_count_augment>;
+
+// check colors and augmented counts, return the black height
+static int check_rb(rb_item *item, bool parent_red)
+{
+    if (item == nullptr)
+    {
+        return 1;
+    }
+    bool red = !(item->hook.parent_color & 1);
+    REQUIRE(!(red && parent_red));
+    rb_item *left = rb_tree::left(*item);
+    rb_item *right = rb_tree::right(*item);
+    if (left)
+    {
+        REQUIRE(rb_tree::parent(*left) == item);
+    }
+    if (right)
+    {
+        REQUIRE(rb_tree::parent(*right) == item);
+    }
+    REQUIRE(item->count == 1 + (left ? left->count : 0) + (right ? right->count : 0));
+    int height = check_rb(left, red);
+    REQUIRE(height == check_rb(right, red));
+    return height + !red;
+}
+
+TEST_CASE("insert intrusive rbtree", "intrusive_rbtree")
+{
+    rb_item items[10];
+    intrusive_rbtree<rb_item, &rb_item::hook, rb_item_less> tree;
+    REQUIRE(tree.empty());
+    REQUIRE(tree.first() == nullptr);
+    REQUIRE(tree.pop_first() == nullptr);
+    for (int i = 0; i < 10; i++)
+    {
+        items[i].key = (i * 7) % 10;
+        REQUIRE(tree.insert_unique(items[i]));
+    }
+    rb_item dup;
+    dup.key = 3;
+    REQUIRE(!tree.insert_unique(dup));
+    REQUIRE(!dup.hook.is_linked());
+    REQUIRE(tree.size() == 10);
+    REQUIRE(tree.first()->key == 0);
+    REQUIRE(tree.last()->key == 9);
+    int expect = 0;
+    for (auto &item : tree)
+    {
+        REQUIRE(item.key == expect++);
+    }
+    REQUIRE(tree.find(4)->key == 4);
+    REQUIRE(tree.find(10) == nullptr);
+    REQUIRE(tree.lower_find(-1)->key == 0);
+    REQUIRE(tree.upper_find(8)->key == 9);
+    REQUIRE(tree.upper_find(9) == nullptr);
+    REQUIRE(tree.next(*tree.find(4))->key == 5);
+    REQUIRE(tree.prev(*tree.find(0)) == nullptr);
+
+    tree.remove(*tree.find(0));
+    REQUIRE(tree.first()->key == 1);
+    REQUIRE(tree.pop_first()->key == 1);
+    REQUIRE(tree.first()->key == 2);
+    REQUIRE(tree.size() == 8);
+    tree.clear();
+    REQUIRE(tree.empty());
+    for (auto &item : items)
+    {
+        REQUIRE(!item.hook.is_linked());
+    }
+}
+
+TEST_CASE("duplicate intrusive rbtree", "intrusive_rbtree")
+{
+    std::vector<rb_item> items(100);
+    rb_tree tree;
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        items[i].key = i % 4;
+        tree.insert(items[i]);
+    }
+    // equal keys keep insertion order
+    rb_item *prev = nullptr;
+    for (auto &item : tree)
+    {
+        if (prev != nullptr && prev->key == item.key)
+        {
+            REQUIRE(prev < &item);
+        }
+        prev = &item;
+    }
+    REQUIRE(tree.find(2) == &items[2]);
+    REQUIRE(tree.root()->count == 100);
+    check_rb(tree.root(), false);
+}
+
+TEST_CASE("random intrusive rbtree", "intrusive_rbtree")
+{
+    std::vector<rb_item> items(2000);
+    rb_tree tree;
+    std::multiset<int> expect;
+    std::mt19937 rng(Catch::rngSeed());
+    for (int i = 0; i < 50000; i++)
+    {
+        rb_item &item = items[rng() % items.size()];
+        if (item.hook.is_linked())
+        {
+            expect.erase(expect.find(item.key));
+            tree.remove(item);
+        }
+        else
+        {
+            item.key = rng() % 500;
+            expect.insert(item.key);
+            tree.insert(item);
+        }
+        REQUIRE(tree.size() == expect.size());
+        if (!expect.empty())
+        {
+            REQUIRE(tree.first()->key == *expect.begin());
+        }
+        if (i % 1000 == 0)
+        {
+            check_rb(tree.root(), false);
+            auto it = tree.begin();
+            for (int key : expect)
+            {
+                REQUIRE(it->key == key);
+                ++it;
+            }
+            REQUIRE(it == tree.end());
+        }
+    }
+    while (!tree.empty())
+    {
+        rb_item *item = tree.pop_first();
+        REQUIRE(item->key == *expect.begin());
+        expect.erase(expect.begin());
+    }
+    REQUIRE(expect.empty());
+}
+
+TEST_CASE("build intrusive rbtree", "intrusive_rbtree")
+{
+    for (size_t n : {0, 1, 2, 3, 6, 100, 1023, 1024})
+    {
+        std::vector<rb_item> items(n + 1);
+        rb_tree tree;
+        tree.insert(items[n]);
+        size_t index = 0;
+        tree.build_sorted(n, [&]() -> rb_item & {
+            items[index].key = index;
+            return items[index++];
+        });
+        REQUIRE(!items[n].hook.is_linked());
+        REQUIRE(tree.size() == n);
+        check_rb(tree.root(), false);
+        if (n > 0)
+        {
+            REQUIRE(tree.first() == &items[0]);
+            REQUIRE(tree.root()->count == n);
+        }
+        for (size_t i = 0; i < n; i += 3)
+        {
+            tree.remove(items[i]);
+        }
+        check_rb(tree.root(), false);
+        rb_tree moved = std::move(tree);
+        REQUIRE(tree.empty());
+        REQUIRE(moved.size() == n - (n + 2) / 3);
+    }
+}
@@ -0,0 +1,151 @@
+#include "freelibcxx/ordered_hash_map.hpp"
+#include "catch2/internal/catch_run_context.hpp"
+#include "common.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace freelibcxx;
+
+TEST_CASE("insert ordered hash map", "ordered_hash_map")
+{
+    ordered_hash_map<int, int> map(&LibAllocatorV, {{5, 6}, {1, 2}, {3, 4}, {1, 7}});
+    REQUIRE(map.size() == 3);
+    REQUIRE(map.get(1).value() == 2);
+    REQUIRE(!map.get(2).has_value());
+
+    auto [it, inserted] = map.insert(2, 3);
+    REQUIRE(inserted);
+    REQUIRE(it->key == 2);
+    REQUIRE(!map.insert(2, 10).second);
+    REQUIRE(!map.insert_or_assign(5, 10).second);
+    REQUIRE(map.get(5).value() == 10);
+
+    int keys[] = {5, 1, 3, 2};
+    size_t i = 0;
+    for (auto &item : map)
+    {
+        REQUIRE(item.key == keys[i++]);
+    }
+    REQUIRE(i == 4);
+    REQUIRE(map.position_of(3) == 2);
+    REQUIRE(map.at(0).value == 10);
+}
+
+TEST_CASE("remove ordered hash map", "ordered_hash_map")
+{
+    ordered_hash_map<int, Int> map(&LibAllocatorV);
+    for (int i = 0; i < 100; i++)
+    {
+        map.insert(i, Int(i));
+    }
+    REQUIRE(map.remove(10));
+    REQUIRE(!map.remove(10));
+    REQUIRE(map.size() == 99);
+    // positions are stable across removes until the holes are compacted
+    REQUIRE(map.position_of(11) == 11);
+    REQUIRE(map.at(11).key == 11);
+    for (int i = 0; i < 100; i++)
+    {
+        REQUIRE(map.has(i) == (i != 10));
+    }
+
+    REQUIRE(map.swap_remove(0));
+    REQUIRE(!map.has(0));
+    REQUIRE(map.at(0).key == 99);
+    REQUIRE(map.get_ptr(99)->v == 99);
+    REQUIRE(map.find(0) == map.end());
+    REQUIRE(map.size() == 98);
+
+    map.clear();
+    REQUIRE(map.empty());
+    REQUIRE(!map.has(50));
+
+    for (int i = 0; i < 1000; i++)
+    {
+        map.insert(i, Int(i));
+    }
+    // remove from the front, holes are compacted and the order is kept
+    for (int i = 0; i < 990; i++)
+    {
+        REQUIRE(map.remove(i));
+    }
+    REQUIRE(map.size() == 10);
+    REQUIRE(map.position_of(990) < 20);
+    int expect = 990;
+    for (auto &item : map)
+    {
+        REQUIRE(item.key == expect++);
+    }
+    REQUIRE(expect == 1000);
+    REQUIRE(map.get_ptr(995)->v == 995);
+}
+
+TEST_CASE("copy ordered hash set", "ordered_hash_map")
+{
+    ordered_hash_set<int> set(&LibAllocatorV, 10);
+    for (int i = 20; i > 0; i--)
+    {
+        set.insert(i);
+    }
+    ordered_hash_set<int> set2 = set;
+    ordered_hash_set<int> set3 = std::move(set);
+    int expect = 20;
+    for (auto &item : set2)
+    {
+        REQUIRE(item.key == expect--);
+    }
+    REQUIRE(set3.has(20));
+    REQUIRE(set3.size() == 20);
+}
+
+TEST_CASE("random ordered hash map", "ordered_hash_map")
+{
+    ordered_hash_map<int, int> map(&LibAllocatorV);
+    std::unordered_map<int, int> m;
+    std::vector<int> order;
+    std::mt19937 rng(Catch::rngSeed());
+    for (int i = 0; i < 5000; i++)
+    {
+        int k = rng() % 800;
+        int op = rng() % 4;
+        if (op == 0)
+        {
+            bool removed = map.remove(k);
+            REQUIRE(removed == (m.erase(k) == 1));
+            if (removed)
+            {
+                std::erase(order, k);
+            }
+        }
+        else if (op == 1)
+        {
+            bool removed = map.swap_remove(k);
+            REQUIRE(removed == (m.erase(k) == 1));
+            if (removed)
+            {
+                auto it = std::find(order.begin(), order.end(), k);
+                *it = order.back();
+                order.pop_back();
+            }
+        }
+        else
+        {
+            bool inserted = map.insert_or_assign(k, i).second;
+            REQUIRE(inserted == (m.count(k) == 0));
+            if (inserted)
+            {
+                order.push_back(k);
+            }
+            m[k] = i;
+        }
+    }
+    REQUIRE(map.size() == m.size());
+    size_t i = 0;
+    for (auto &item : map)
+    {
+        REQUIRE(item.key == order[i++]);
+        REQUIRE(item.value == m[item.key]);
+    }
+}
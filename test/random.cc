@@ -35,3 +35,4 @@ template <typename E> void testing()
 
 TEST_CASE("mt19937 rng", "random") { testing<mt19937_random_engine>(); }
 TEST_CASE("linear rng", "random") { testing<linear_random_engine>(); }
+TEST_CASE("xorshift rng", "random") { testing<xorshift_random_engine>(); }
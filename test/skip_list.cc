@@ -2,6 +2,9 @@
 #include "catch2/internal/catch_run_context.hpp"
 #include "common.hpp"
 #include <catch2/catch_test_macros.hpp>
+#include <random>
+#include <set>
+#include <vector>
 
 using namespace freelibcxx;
 
@@ -131,3 +134,194 @@ TEST_CASE("find binary in skip list", "skip_list")
     iter = list.lower_find(5);
     REQUIRE(iter == list.end());
 }
+
+TEST_CASE("finger insert skip list", "skip_list")
+{
+    skip_list<int> list(&LibAllocatorV, Catch::rngSeed());
+    std::multiset<int> expect;
+    std::mt19937 rng(Catch::rngSeed());
+    int base = 0;
+    for (int i = 0; i < 20000; i++)
+    {
+        // mostly nearby keys, with jumps back
+        int k = rng() % 8 == 0 ? (int)(rng() % 1000) : base + (int)(rng() % 16);
+        base++;
+        if (rng() % 4 == 0)
+        {
+            auto it = expect.find(k);
+            REQUIRE(list.remove(k) == (it != expect.end()));
+            if (it != expect.end())
+            {
+                expect.erase(it);
+            }
+        }
+        else
+        {
+            list.insert(k);
+            expect.insert(k);
+        }
+    }
+    REQUIRE(list.size() == expect.size());
+    auto it = list.begin();
+    for (int k : expect)
+    {
+        REQUIRE(*it == k);
+        it++;
+    }
+    REQUIRE(it == list.end());
+    for (int k = 0; k < 1000; k++)
+    {
+        REQUIRE(list.has(k) == (expect.count(k) != 0));
+    }
+}
+
+TEST_CASE("append skip list", "skip_list")
+{
+    skip_list<int> list(&LibAllocatorV, Catch::rngSeed());
+    std::vector<int> items;
+    for (int i = 0; i < 1000; i++)
+    {
+        items.push_back(i * 2);
+    }
+    list.append_sorted(span<const int>(items.data(), items.size()));
+    auto it = list.insert_hint(list.end(), 2000);
+    REQUIRE(*it == 2000);
+    // a wrong hint still inserts in order
+    list.insert_hint(list.end(), 5);
+    list.insert_hint(list.find(10), 9);
+    REQUIRE(list.size() == 1003);
+    int last = -1;
+    for (int v : list)
+    {
+        REQUIRE(v >= last);
+        last = v;
+    }
+    auto back = list.find(9);
+    back--;
+    REQUIRE(*back == 8);
+    back = list.find(6);
+    back--;
+    REQUIRE(*back == 5);
+}
+
+TEST_CASE("append equal skip list", "skip_list")
+{
+    struct tagged
+    {
+        int key;
+        int tag;
+        bool operator<(const tagged &rhs) const { return key < rhs.key; }
+    };
+    skip_list<tagged> list(&LibAllocatorV, Catch::rngSeed());
+    list.insert(tagged{1, 0});
+    list.insert_hint(list.end(), tagged{2, 0});
+    // an equal element goes before the existing ones, with or without the hint
+    list.insert_hint(list.end(), tagged{2, 1});
+    list.insert(tagged{2, 2});
+    list.insert_hint(list.end(), tagged{2, 3});
+    list.insert_hint(list.end(), tagged{3, 0});
+    int expect[][2] = {{1, 0}, {2, 3}, {2, 2}, {2, 1}, {2, 0}, {3, 0}};
+    auto it = list.begin();
+    for (auto &e : expect)
+    {
+        REQUIRE(it->key == e[0]);
+        REQUIRE(it->tag == e[1]);
+        it++;
+    }
+    REQUIRE(it == list.end());
+}
+
+TEST_CASE("build skip list", "skip_list")
+{
+    skip_list<int> list(&LibAllocatorV, Catch::rngSeed(), {7, 8});
+    std::vector<int> items;
+    for (int i = 0; i < 5000; i++)
+    {
+        items.push_back(i / 2);
+    }
+    list.build_sorted(span<const int>(items.data(), items.size()));
+    REQUIRE(list.size() == 5000);
+    REQUIRE(list.front() == 0);
+    for (int i = 0; i < 2500; i++)
+    {
+        REQUIRE(*list.lower_find(i) == i);
+    }
+    REQUIRE(!list.has(2500));
+
+    skip_list<int> copy = list;
+    REQUIRE(copy.size() == 5000);
+    auto it = copy.begin();
+    for (int v : items)
+    {
+        REQUIRE(*it == v);
+        it++;
+    }
+    copy.insert(-1);
+    copy.insert(6000);
+    REQUIRE(copy.front() == -1);
+    REQUIRE(copy.remove(100));
+    REQUIRE(copy.remove(100));
+    REQUIRE(!copy.has(100));
+    REQUIRE(list.has(100));
+
+    list.build_sorted(span<const int>(items.data(), 0));
+    REQUIRE(list.empty());
+    list.insert(1);
+    REQUIRE(list.front() == 1);
+}
+
+TEST_CASE("level skip list", "skip_list")
+{
+    skip_list<int, mt19937_random_engine, 12, 2> list(&LibAllocatorV, Catch::rngSeed());
+    for (int i = 0; i < 4096; i++)
+    {
+        list.insert_hint(list.end(), i);
+    }
+    // 1/4 promotion, about log4(4096) levels
+    REQUIRE(list.deep() >= 3);
+    REQUIRE(list.deep() < 12);
+    for (int i = 0; i < 4096; i += 3)
+    {
+        REQUIRE(list.remove(i));
+    }
+    for (int i = 0; i < 4096; i++)
+    {
+        REQUIRE(list.has(i) == (i % 3 != 0));
+    }
+}
+
+TEST_CASE("range skip list", "skip_list")
+{
+    skip_list<int> list(&LibAllocatorV, Catch::rngSeed());
+    for (int i = 0; i < 1000; i++)
+    {
+        list.insert(i);
+    }
+    REQUIRE(list.count_range(100, 200) == 100);
+    REQUIRE(list.count_range(-10, 5) == 5);
+    REQUIRE(list.count_range(5, 5) == 0);
+    int sum = 0;
+    list.for_each_range(10, 15, [&](const int &v) { sum += v; });
+    REQUIRE(sum == 10 + 11 + 12 + 13 + 14);
+
+    REQUIRE(list.erase_range(100, 200) == 100);
+    REQUIRE(list.erase_range(100, 200) == 0);
+    REQUIRE(list.erase_range(300, 250) == 0);
+    REQUIRE(list.size() == 900);
+    for (int i = 0; i < 1000; i++)
+    {
+        REQUIRE(list.has(i) == (i < 100 || i >= 200));
+    }
+    auto it = list.find(200);
+    it--;
+    REQUIRE(*it == 99);
+    REQUIRE(list.erase_range(-1, 50) == 50);
+    REQUIRE(list.front() == 50);
+    REQUIRE(list.erase_range(990, 2000) == 10);
+    list.insert(995);
+    REQUIRE(list.count_range(0, 2000) == 841);
+    REQUIRE(list.erase_range(0, 2000) == 841);
+    REQUIRE(list.empty());
+    list.insert(1);
+    REQUIRE(list.front() == 1);
+}
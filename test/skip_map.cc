@@ -0,0 +1,132 @@
+#include "freelibcxx/skip_map.hpp"
+#include "catch2/internal/catch_run_context.hpp"
+#include "common.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <map>
+#include <random>
+
+using namespace freelibcxx;
+
+TEST_CASE("insert skip map", "skip_map")
+{
+    skip_map<int, Int> map(&LibAllocatorV, Catch::rngSeed());
+    REQUIRE(map.empty());
+    REQUIRE(map.insert(3, 30).second);
+    REQUIRE(map.insert(1, 10).second);
+    REQUIRE(!map.insert(3, 31).second);
+    REQUIRE(map.get(3).value().v == 30);
+    REQUIRE(!map.insert_or_assign(3, 33).second);
+    REQUIRE(map.get_ptr(3)->v == 33);
+    REQUIRE(map.get_ptr(2) == nullptr);
+    REQUIRE(map.insert_or_assign(2, 20).second);
+    REQUIRE(map.size() == 3);
+
+    int expect = 1;
+    for (auto &pair : map)
+    {
+        REQUIRE(pair.key == expect);
+        REQUIRE(pair.value.v == expect * 10 + (expect == 3 ? 3 : 0));
+        expect++;
+    }
+    auto it = map.find(3);
+    --it;
+    REQUIRE(it->key == 2);
+    REQUIRE(map.lower_find(0)->key == 1);
+    REQUIRE(map.upper_find(1)->key == 2);
+    REQUIRE(map.upper_find(3) == map.end());
+}
+
+TEST_CASE("comparator skip map", "skip_map")
+{
+    skip_map<int, int, std::greater<int>> map(&LibAllocatorV, Catch::rngSeed());
+    for (int i = 0; i < 10; i++)
+    {
+        map.insert(i, i);
+    }
+    REQUIRE(map.begin()->key == 9);
+    REQUIRE(map.rank(7) == 2);
+    REQUIRE(map.at(0).key == 9);
+    REQUIRE(map.count_range(8, 3) == 5);
+    REQUIRE(map.count_range(3, 8) == 0);
+}
+
+TEST_CASE("rank select skip map", "skip_map")
+{
+    skip_map<int, int> map(&LibAllocatorV, Catch::rngSeed());
+    for (int i = 0; i < 1000; i++)
+    {
+        map.insert(i * 2, i);
+    }
+    for (int i = 0; i < 1000; i++)
+    {
+        REQUIRE(map.rank(i * 2) == (size_t)i);
+        REQUIRE(map.rank(i * 2 + 1) == (size_t)i + 1);
+        REQUIRE(map.select(i)->key == i * 2);
+        REQUIRE(map.at(i).value == i);
+    }
+    REQUIRE(map.select(1000) == map.end());
+    REQUIRE(map.count_range(10, 20) == 5);
+    REQUIRE(map.count_range(-5, 5000) == 1000);
+
+    for (int i = 0; i < 1000; i += 2)
+    {
+        REQUIRE(map.remove(i * 2));
+    }
+    REQUIRE(!map.remove(0));
+    REQUIRE(map.size() == 500);
+    for (int i = 0; i < 500; i++)
+    {
+        REQUIRE(map.select(i)->key == i * 4 + 2);
+        REQUIRE(map.rank(i * 4 + 2) == (size_t)i);
+    }
+    auto it = map.remove(map.select(0));
+    REQUIRE(it->key == 6);
+    REQUIRE(map.at(0).key == 6);
+}
+
+TEST_CASE("random skip map", "skip_map")
+{
+    skip_map<int, int> map(&LibAllocatorV, Catch::rngSeed());
+    std::map<int, int> expect;
+    std::mt19937 rng(Catch::rngSeed());
+    for (int i = 0; i < 20000; i++)
+    {
+        int k = rng() % 2000;
+        if (rng() % 3 == 0)
+        {
+            REQUIRE(map.remove(k) == (expect.erase(k) == 1));
+        }
+        else
+        {
+            REQUIRE(map.insert(k, k).second == expect.emplace(k, k).second);
+        }
+        if (i % 100 == 0)
+        {
+            REQUIRE(map.size() == expect.size());
+            size_t index = 0;
+            for (auto &[key, value] : expect)
+            {
+                REQUIRE(map.rank(key) == index);
+                REQUIRE(map.at(index).key == key);
+                index++;
+            }
+        }
+    }
+
+    skip_map<int, int> map2 = map;
+    REQUIRE(map2.size() == expect.size());
+    size_t index = 0;
+    for (auto &[key, value] : expect)
+    {
+        REQUIRE(map2.at(index++).key == key);
+        REQUIRE(map2.rank(key) == map.rank(key));
+    }
+    map2.insert(-1, 0);
+    REQUIRE(map2.at(0).key == -1);
+    skip_map<int, int> map3 = std::move(map2);
+    REQUIRE(map3.size() == expect.size() + 1);
+    map3.clear();
+    REQUIRE(map3.empty());
+    map3.insert(1, 1);
+    REQUIRE(map3.rank(1) == 0);
+}
@@ -0,0 +1,61 @@
+#include "freelibcxx/static_map.hpp"
+#include "common.hpp"
+#include <catch2/catch_test_macros.hpp>
+
+using namespace freelibcxx;
+
+TEST_CASE("constexpr hash", "static_map")
+{
+    static_assert(detail::djb_hash("abc") == 193485963);
+    constexpr uint64_t h = detail::wyhash("hello world, this is a long key for all paths!!", 48, 0);
+    const char *runtime = "hello world, this is a long key for all paths!!";
+    REQUIRE(detail::wyhash((const void *)runtime, 48, 0) == h);
+
+    for (size_t len = 0; len < 48; len++)
+    {
+        REQUIRE(detail::wyhash(runtime, len, 3) == detail::wyhash((const void *)runtime, len, 3));
+        REQUIRE(detail::murmur_hash2_64(runtime, len, 3) == detail::murmur_hash2_64((const void *)runtime, len, 3));
+    }
+    static_assert(detail::murmur_hash2_64("\xff\xfe", 2, 0) != 0);
+    const char high[] = "\xff\xfe";
+    REQUIRE(detail::murmur_hash2_64(high, 2, 0) == detail::murmur_hash2_64((const void *)high, 2, 0));
+}
+
+TEST_CASE("static map", "static_map")
+{
+    static constexpr auto map = make_static_map<int>({{"GET", 1}, {"POST", 2}, {"PUT", 3}, {"", 4}, {"DELETE", 5}});
+    REQUIRE(map.size() == 5);
+    REQUIRE(*map.get("GET") == 1);
+    REQUIRE(*map.get("POST") == 2);
+    REQUIRE(*map.get("PUT") == 3);
+    REQUIRE(*map.get("") == 4);
+    REQUIRE(*map.get("DELETE") == 5);
+    REQUIRE(map.get("GETS") == nullptr);
+    REQUIRE(map.get("get") == nullptr);
+    REQUIRE(map.has(const_string_view("PUTX", 3)));
+}
+
+TEST_CASE("string switch", "static_map")
+{
+    static constexpr string_switch commands({"open", "close", "read", "write"});
+    auto dispatch = [](const char *name) {
+        switch (commands(name))
+        {
+            case commands.index_of("open"):
+                return 1;
+            case commands.index_of("close"):
+                return 2;
+            case commands.index_of("write"):
+                return 4;
+            default:
+                return 0;
+        }
+    };
+    REQUIRE(dispatch("open") == 1);
+    REQUIRE(dispatch("close") == 2);
+    REQUIRE(dispatch("read") == 0);
+    REQUIRE(dispatch("write") == 4);
+    REQUIRE(dispatch("seek") == 0);
+    REQUIRE(commands("read") == 2);
+    REQUIRE(commands("x") == -1);
+}